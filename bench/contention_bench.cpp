@@ -0,0 +1,59 @@
+#include <suiveur/suiveur.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+    using registry = suiveur::allocation_registry;
+
+    constexpr std::size_t ops_per_thread = 250'000;
+    constexpr std::size_t live_per_thread = 1024;
+
+    /* Each thread churns through its own address range, so only the registry is shared. */
+    void worker(std::size_t thread_idx) {
+        const auto base = std::uintptr_t { 0x10000000 } + thread_idx * std::uintptr_t { 0x10000000 };
+        auto addr = [&](std::size_t idx) { return reinterpret_cast<void*>(base + idx * 32); };
+        const suiveur::type_id type = suiveur::cttype_id<int>;
+        const auto* site = SUIVEUR_CALL_SITE();
+
+        for(std::size_t idx = 0; idx < live_per_thread; ++idx) registry::record_allocation(addr(idx), type, site);
+        for(std::size_t idx = 0; idx < ops_per_thread; ++idx) {
+            registry::safe_deletion(addr(idx), type, site);
+            registry::record_allocation(addr(idx + live_per_thread), type, site);
+        }
+        for(std::size_t idx = ops_per_thread; idx < ops_per_thread + live_per_thread; ++idx) {
+            registry::safe_deletion(addr(idx), type, site);
+        }
+    }
+
+    double run(std::size_t threads) {
+        std::vector<std::thread> pool;
+        auto start = clock_type::now();
+        for(std::size_t idx = 0; idx < threads; ++idx) pool.emplace_back(worker, idx);
+        for(auto& t : pool) t.join();
+        auto stop = clock_type::now();
+        return std::chrono::duration<double>(stop - start).count();
+    }
+}
+
+int main() {
+#ifdef SUIVEUR_THREAD_SAFE
+    const std::size_t max_threads = std::max(16u, std::thread::hardware_concurrency());
+#else
+    const std::size_t max_threads = 1;
+    std::printf("registry built without thread_safe, only running a single thread\n");
+#endif
+    std::printf("%8s %14s %10s %10s\n", "threads", "Mops/s", "speedup", "per-thread");
+    double base = 0.0;
+    for(std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+        const double seconds = run(threads);
+        const double mops = double(threads * ops_per_thread * 2) / seconds / 1e6;
+        if(threads == 1) base = mops;
+        std::printf("%8zu %14.2f %10.2f %10.2f\n", threads, mops, mops / base, mops / base / double(threads));
+    }
+}
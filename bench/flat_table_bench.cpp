@@ -0,0 +1,73 @@
+#include <suiveur/suiveur.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    std::vector<void*> make_addresses(std::size_t count, std::mt19937_64& rng) {
+        std::vector<void*> addrs(count);
+        for(std::size_t idx = 0; idx < count; ++idx) {
+            addrs[idx] = reinterpret_cast<void*>(std::uintptr_t { 0x100000 } + idx * 32);
+        }
+        std::shuffle(addrs.begin(), addrs.end(), rng);
+        return addrs;
+    }
+
+    template <typename F>
+    double time_per_op(std::size_t ops, F&& f) {
+        auto start = clock_type::now();
+        f();
+        auto stop = clock_type::now();
+        return std::chrono::duration<double, std::nano>(stop - start).count() / double(ops);
+    }
+
+    /* Keeps `live` entries resident while replacing one entry per op. */
+    template <typename Insert, typename Erase, typename Find>
+    void churn(const char* name, std::size_t live, Insert&& insert, Erase&& erase, Find&& find) {
+        std::mt19937_64 rng { 77 };
+        const std::size_t ops = std::max<std::size_t>(live, 1'000'000);
+        auto addrs = make_addresses(live + ops, rng);
+
+        for(std::size_t idx = 0; idx < live; ++idx) insert(addrs[idx]);
+
+        std::size_t hits = 0;
+        const double find_ns = time_per_op(ops, [&] {
+            for(std::size_t idx = 0; idx < ops; ++idx) hits += find(addrs[(idx * 7919) % live]);
+        });
+        const double churn_ns = time_per_op(ops, [&] {
+            for(std::size_t idx = 0; idx < ops; ++idx) {
+                erase(addrs[idx]);
+                insert(addrs[live + idx]);
+            }
+        });
+        std::printf("%-10s %10zu %12.2f %12.2f %s\n", name, live, find_ns, churn_ns, hits == ops ? "" : "(miss)");
+    }
+}
+
+int main() {
+    std::printf("%-10s %10s %12s %12s\n", "table", "live", "find ns/op", "churn ns/op");
+    for(std::size_t live = 1'000; live <= 10'000'000; live *= 10) {
+        {
+            std::map<void*, suiveur::allocation_registry::allocation_key> table;
+            churn("std::map", live,
+                  [&](void* p) { table.emplace(p, suiveur::allocation_registry::allocation_key { p, nullptr, nullptr }); },
+                  [&](void* p) { table.erase(p); },
+                  [&](void* p) { return table.count(p); });
+        }
+        {
+            suiveur::flat_table<void*, suiveur::allocation_registry::allocation_key> table;
+            churn("flat_table", live,
+                  [&](void* p) { table.try_emplace(p).first->value = { p, nullptr, nullptr }; },
+                  [&](void* p) { table.erase(p); },
+                  [&](void* p) { return std::size_t { table.find(p) != nullptr }; });
+        }
+    }
+}
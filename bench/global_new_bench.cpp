@@ -0,0 +1,38 @@
+#include <suiveur/suiveur.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    constexpr std::size_t ops = 2'000'000;
+    constexpr std::size_t live = 4096;
+
+    template <typename Alloc, typename Free>
+    double churn(Alloc&& alloc, Free&& release) {
+        std::vector<void*> slots(live, nullptr);
+        auto start = clock_type::now();
+        for(std::size_t idx = 0; idx < ops; ++idx) {
+            auto& slot = slots[(idx * 7919) % live];
+            if(slot) release(slot);
+            slot = alloc(16 + (idx % 8) * 16);
+        }
+        auto stop = clock_type::now();
+        for(auto* slot : slots) if(slot) release(slot);
+        return std::chrono::duration<double, std::nano>(stop - start).count() / double(ops);
+    }
+}
+
+int main() {
+    if constexpr(not suiveur::track_global_new) {
+        std::printf("built without track_global_new, operator new is not interposed\n");
+    }
+    const double raw = churn([](std::size_t size) { return std::malloc(size); }, [](void* ptr) { std::free(ptr); });
+    const double tracked = churn([](std::size_t size) { return ::operator new(size); }, [](void* ptr) { ::operator delete(ptr); });
+    std::printf("%-16s %10.2f ns/op\n", "malloc/free", raw);
+    std::printf("%-16s %10.2f ns/op\n", "new/delete", tracked);
+    std::printf("%-16s %10.2fx\n", "overhead", tracked / raw);
+}
@@ -0,0 +1,64 @@
+#include <suiveur/suiveur.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    /* The find loop partition_data used before index_lines. */
+    std::vector<std::string_view> find_loop(const std::string& data) {
+        std::size_t pos = 0, off;
+        std::vector<std::string_view> views;
+        while((off = data.find('\n', pos)) != std::string::npos) {
+            views.emplace_back(data.data() + pos, off - pos);
+            pos = off + 1;
+        }
+        views.emplace_back(data.data() + pos, data.size() - pos);
+        return views;
+    }
+
+    std::string make_source(std::size_t bytes, std::size_t mean_line, bool crlf) {
+        std::mt19937_64 rng { 42 };
+        std::uniform_int_distribution<std::size_t> length { 0, mean_line * 2 };
+        std::string data;
+        data.reserve(bytes + mean_line * 2);
+        while(data.size() < bytes) {
+            data.append(length(rng), 'x');
+            data += crlf ? "\r\n" : "\n";
+        }
+        return data;
+    }
+
+    template <typename F>
+    void run(const char* name, const std::string& data, std::size_t mean_line, F&& f) {
+        constexpr int rounds = 20;
+        std::size_t lines = 0;
+        const auto start = clock_type::now();
+        for(int round = 0; round < rounds; ++round) lines += f(data);
+        const auto stop = clock_type::now();
+        const double seconds = std::chrono::duration<double>(stop - start).count();
+        std::printf("%-16s %6zu %12zu %10.1f\n", name, mean_line, lines / rounds,
+                    double(data.size()) * rounds / seconds / 1e6);
+    }
+}
+
+int main() {
+    std::printf("dispatched to %s\n", suiveur::line_index_isa());
+    std::printf("%-16s %6s %12s %10s\n", "routine", "line", "lines", "MB/s");
+    for(std::size_t mean_line : { 8, 40, 120 }) {
+        const std::string data = make_source(std::size_t { 8 } << 20, mean_line, mean_line == 40);
+        run("find loop", data, mean_line, [](const std::string& d) { return find_loop(d).size(); });
+        run("partition_data", data, mean_line, [](const std::string& d) { return suiveur::partition_data(d).size(); });
+        run("index_lines", data, mean_line, [](const std::string& d) {
+            std::vector<std::uint32_t> starts { 0 };
+            suiveur::index_lines(d, 0, starts);
+            return starts.size();
+        });
+    }
+}
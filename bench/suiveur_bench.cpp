@@ -0,0 +1,324 @@
+#include <suiveur/suiveur.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+ * Overhead of the registry as seen by a program, run it against builds with and without
+ * enable_tracking (or thread_safe, sample_interval, ...) and compare.
+ *
+ *   suiveur_bench [--json] [--quick] [--filter <substring>] [--repetitions <n>]
+ *
+ * --json prints one object per line, the first describing the build, the rest one result each.
+ * alloc/dormant runs the tracked workload with tracking switched off at runtime.
+ */
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+    using registry = suiveur::allocation_registry;
+
+    struct payload {
+        std::uint64_t data[4];
+    };
+
+    struct options {
+        std::string filter;
+        std::size_t repetitions = 3;
+        bool json = false;
+        bool quick = false;
+    };
+
+    template <typename F>
+    double elapsed_ns(F&& f) {
+        const auto start = clock_type::now();
+        f();
+        const auto stop = clock_type::now();
+        return std::chrono::duration<double, std::nano>(stop - start).count();
+    }
+
+    struct suite {
+        options opts;
+
+        [[nodiscard]] bool selected(const std::string& name) const {
+            return opts.filter.empty() or name.find(opts.filter) != std::string::npos;
+        }
+
+        /* Body does its own setup and returns the nanoseconds spent on the measured part, the best run is kept. */
+        template <typename F>
+        void run(const std::string& name, const std::string& param, const std::size_t ops, F&& body,
+                 const std::size_t repetitions = 0) {
+            if(not selected(name)) return;
+            double best = 0;
+            for(std::size_t rep = 0; rep < (repetitions ? repetitions : opts.repetitions); ++rep) {
+                const double ns = body();
+                if(rep == 0 or ns < best) best = ns;
+            }
+            const double ns_per_op = best / double(ops);
+            if(opts.json) {
+                std::printf("{\"name\":\"%s\",\"param\":\"%s\",\"ops\":%zu,\"ns_per_op\":%.3f,\"mops_per_s\":%.3f}\n",
+                            name.c_str(), param.c_str(), ops, ns_per_op, 1e3 / ns_per_op);
+            }
+            else std::printf("%-28s %-14s %12.2f %12.2f\n", name.c_str(), param.c_str(), ns_per_op, 1e3 / ns_per_op);
+            std::fflush(stdout);
+        }
+    };
+
+    void print_config(const options& opts) {
+#ifdef ENABLE_MEMORY_REGISTRY
+        constexpr bool tracking = true;
+#else
+        constexpr bool tracking = false;
+#endif
+#ifdef SUIVEUR_EVENT_LOG
+        constexpr bool event_log = true;
+#else
+        constexpr bool event_log = false;
+#endif
+        auto flag = [](bool value) { return value ? "true" : "false"; };
+        if(opts.json) {
+            std::printf("{\"config\":{\"tracking\":%s,\"thread_safe\":%s,\"registry_shards\":%zu,\"thread_cache_size\":%zu,"
+                        "\"sample_interval\":%zu,\"track_global_new\":%s,\"event_log\":%s,\"quarantine_size\":%zu,"
+                        "\"quick\":%s,\"repetitions\":%zu}}\n",
+                        flag(tracking), flag(suiveur::thread_safe), suiveur::registry_shards, suiveur::thread_cache_size,
+                        suiveur::sample_interval, flag(suiveur::track_global_new), flag(event_log), suiveur::quarantine_size,
+                        flag(opts.quick), opts.repetitions);
+        }
+        else {
+            std::printf("tracking %s, thread_safe %s, shards %zu, thread cache %zu, sample interval %zu, "
+                        "global new %s, event log %s, quarantine %zu\n\n",
+                        flag(tracking), flag(suiveur::thread_safe), suiveur::registry_shards, suiveur::thread_cache_size,
+                        suiveur::sample_interval, flag(suiveur::track_global_new), flag(event_log), suiveur::quarantine_size);
+            std::printf("%-28s %-14s %12s %12s\n", "benchmark", "param", "ns/op", "Mops/s");
+        }
+    }
+
+    /* Raw and tracked allocation through the same loop, so their difference is the registry. */
+    struct raw_heap {
+        static payload* make() { return new payload {}; }
+        static void release(payload* ptr) { delete ptr; }
+    };
+
+    struct tracked_heap {
+        static payload* make() { return REGISTER_ALLOC(new payload {}); }
+        static void release(payload* ptr) { SAFE_DELETE(ptr); }
+    };
+
+    /* Keeps `live` objects resident while replacing one per op, in a scattered order. */
+    template <typename Heap>
+    double replace_live(const std::size_t live, const std::size_t ops) {
+        std::vector<payload*> slots(live);
+        for(auto& slot : slots) slot = Heap::make();
+        const double ns = elapsed_ns([&] {
+            for(std::size_t idx = 0; idx < ops; ++idx) {
+                auto& slot = slots[(idx * 7919) % live];
+                Heap::release(slot);
+                slot = Heap::make();
+            }
+        });
+        for(auto* slot : slots) Heap::release(slot);
+        return ns;
+    }
+
+    /* Bursts allocated and freed newest first, as scoped objects are. */
+    template <typename Heap>
+    double churn_lifo(const std::size_t ops) {
+        constexpr std::size_t burst = 64;
+        std::vector<payload*> stack(burst);
+        return elapsed_ns([&] {
+            for(std::size_t done = 0; done < ops; done += burst) {
+                for(auto& slot : stack) slot = Heap::make();
+                for(auto it = stack.rbegin(); it != stack.rend(); ++it) Heap::release(*it);
+            }
+        });
+    }
+
+    /* Oldest freed first, as queued work items are. */
+    template <typename Heap>
+    double churn_fifo(const std::size_t live, const std::size_t ops) {
+        std::vector<payload*> ring(live);
+        for(auto& slot : ring) slot = Heap::make();
+        const double ns = elapsed_ns([&] {
+            for(std::size_t idx = 0; idx < ops; ++idx) {
+                auto& slot = ring[idx % live];
+                Heap::release(slot);
+                slot = Heap::make();
+            }
+        });
+        for(auto* slot : ring) Heap::release(slot);
+        return ns;
+    }
+
+    template <typename Heap>
+    double churn_random(const std::size_t live, const std::size_t ops) {
+        std::mt19937_64 rng { 77 };
+        std::vector<std::uint32_t> order(ops);
+        for(auto& idx : order) idx = static_cast<std::uint32_t>(rng() % live);
+        std::vector<payload*> slots(live);
+        for(auto& slot : slots) slot = Heap::make();
+        const double ns = elapsed_ns([&] {
+            for(const auto idx : order) {
+                Heap::release(slots[idx]);
+                slots[idx] = Heap::make();
+            }
+        });
+        for(auto* slot : slots) Heap::release(slot);
+        return ns;
+    }
+
+    /* Wall time over the total ops of every thread, each churning its own objects. */
+    double contention(const std::size_t threads, const std::size_t ops_per_thread) {
+        std::vector<std::thread> pool;
+        return elapsed_ns([&] {
+            for(std::size_t idx = 0; idx < threads; ++idx) {
+                pool.emplace_back([ops_per_thread] { replace_live<tracked_heap>(1024, ops_per_thread); });
+            }
+            for(auto& t : pool) t.join();
+        });
+    }
+
+    /* Synthetic addresses, the registry never frees what it is handed. */
+    void* fake_address(const std::size_t idx) {
+        return reinterpret_cast<void*>(std::uintptr_t { 0x7000'0000'0000 } + idx * 64);
+    }
+
+    /* Every delete after the first goes through find_deleted and records an error. */
+    double double_deletes(const std::size_t addresses, const std::size_t ops) {
+        const suiveur::type_id type = suiveur::cttype_id<payload>;
+        const auto* site = SUIVEUR_CALL_SITE();
+        for(std::size_t idx = 0; idx < addresses; ++idx) {
+            registry::record_allocation(fake_address(idx), type, site, sizeof(payload));
+            registry::safe_deletion(fake_address(idx), type, site);
+        }
+        const double ns = elapsed_ns([&] {
+            for(std::size_t idx = 0; idx < ops; ++idx) registry::safe_deletion(fake_address(idx % addresses), type, site);
+        });
+        registry::pass();
+        return ns;
+    }
+
+    double untracked_deletes(const std::size_t ops) {
+        const suiveur::type_id type = suiveur::cttype_id<payload>;
+        const auto* site = SUIVEUR_CALL_SITE();
+        const double ns = elapsed_ns([&] {
+            for(std::size_t idx = 0; idx < ops; ++idx) registry::safe_deletion(fake_address(idx + (std::size_t { 1 } << 24)), type, site);
+        });
+        registry::pass();
+        return ns;
+    }
+
+    /* A generated source file, reports quote a line of it for every error. */
+    struct large_source {
+        std::filesystem::path path;
+        std::string name;
+        std::vector<suiveur::call_site> sites;
+
+        large_source(const std::size_t lines, const std::size_t errors) {
+            path = std::filesystem::temp_directory_path() / "suiveur_bench_source.cpp";
+            std::ofstream os { path };
+            for(std::size_t line = 1; line <= lines; ++line) {
+                os << "    auto value_" << line << " = combine(value_" << line - 1 << ", " << line << ");\n";
+            }
+            name = path.string();
+            sites.reserve(errors);
+            for(std::size_t idx = 0; idx < errors; ++idx) sites.push_back(suiveur::call_site { name.c_str(), 1 + (idx * 7919) % lines });
+        }
+
+        ~large_source() {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    };
+
+    /* Errors at distinct sites, so each one is rendered with its own source line. */
+    double render_errors(const large_source& source, std::size_t& rendered) {
+        const suiveur::type_id type = suiveur::cttype_id<payload>;
+        for(std::size_t idx = 0; idx < source.sites.size(); ++idx) {
+            registry::safe_deletion(fake_address(idx + (std::size_t { 1 } << 28)), type, &source.sites[idx]);
+        }
+        rendered = 0;
+        registry::set_report_sink(suiveur::report_sink::to_callback([&](std::string_view text) { rendered += text.size(); }));
+        const double ns = elapsed_ns([] { registry::print_errors(); });
+        registry::set_report_sink(suiveur::report_sink::to_callback([](std::string_view) {}));
+        registry::pass();
+        return ns;
+    }
+
+    std::string param(const char* key, const std::size_t value) {
+        return std::string { key } + '=' + std::to_string(value);
+    }
+}
+
+int main(int argc, char** argv) {
+    options opts;
+    for(int idx = 1; idx < argc; ++idx) {
+        const std::string_view arg { argv[idx] };
+        if(arg == "--json") opts.json = true;
+        else if(arg == "--quick") opts.quick = true;
+        else if(arg == "--filter" and idx + 1 < argc) opts.filter = argv[++idx];
+        else if(arg == "--repetitions" and idx + 1 < argc) opts.repetitions = std::max(1, std::atoi(argv[++idx]));
+        else {
+            std::fprintf(stderr, "usage: %s [--json] [--quick] [--filter <substring>] [--repetitions <n>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    /* Reports of the workloads themselves would drown the results. */
+    registry::set_report_sink(suiveur::report_sink::to_callback([](std::string_view) {}));
+    print_config(opts);
+    suite s { opts };
+
+    const std::size_t ops = opts.quick ? 200'000 : 2'000'000;
+    const std::vector<std::size_t> live_sizes = opts.quick ? std::vector<std::size_t> { 1'000, 100'000 }
+                                                           : std::vector<std::size_t> { 1'000, 100'000, 1'000'000 };
+    for(const auto live : live_sizes) {
+        s.run("alloc/raw", param("live", live), ops, [&] { return replace_live<raw_heap>(live, ops); });
+        s.run("alloc/tracked", param("live", live), ops, [&] { return replace_live<tracked_heap>(live, ops); });
+        /* Nothing recorded is live after the reset, so deletions don't look anything up either. */
+        suiveur::tracking_switch::disable();
+        registry::erase();
+        s.run("alloc/dormant", param("live", live), ops, [&] { return replace_live<tracked_heap>(live, ops); });
+        suiveur::tracking_switch::enable();
+    }
+
+    constexpr std::size_t churn_live = 10'000;
+    s.run("churn/lifo/raw", param("burst", 64), ops, [&] { return churn_lifo<raw_heap>(ops); });
+    s.run("churn/lifo/tracked", param("burst", 64), ops, [&] { return churn_lifo<tracked_heap>(ops); });
+    s.run("churn/fifo/raw", param("live", churn_live), ops, [&] { return churn_fifo<raw_heap>(churn_live, ops); });
+    s.run("churn/fifo/tracked", param("live", churn_live), ops, [&] { return churn_fifo<tracked_heap>(churn_live, ops); });
+    s.run("churn/random/raw", param("live", churn_live), ops, [&] { return churn_random<raw_heap>(churn_live, ops); });
+    s.run("churn/random/tracked", param("live", churn_live), ops, [&] { return churn_random<tracked_heap>(churn_live, ops); });
+
+    if constexpr(suiveur::thread_safe) {
+        const std::size_t max_threads = std::max(4u, std::thread::hardware_concurrency());
+        const std::size_t per_thread = ops / 4;
+        for(std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+            s.run("contention/tracked", param("threads", threads), threads * per_thread,
+                  [&] { return contention(threads, per_thread); });
+        }
+    }
+
+    constexpr std::size_t error_addresses = 10'000;
+    s.run("errors/double_delete", param("addresses", error_addresses), ops / 4,
+          [&] { return double_deletes(error_addresses, ops / 4); });
+    s.run("errors/untracked", param("addresses", ops / 4), ops / 4, [&] { return untracked_deletes(ops / 4); });
+
+    if(s.selected("report/render")) {
+        const std::size_t lines = opts.quick ? 20'000 : 200'000;
+        const std::size_t errors = opts.quick ? 500 : 5'000;
+        const large_source source { lines, errors };
+        std::size_t rendered = 0;
+        /* The first report maps and indexes the source, later ones reuse it. */
+        s.run("report/render/cold", param("errors", errors), errors, [&] { return render_errors(source, rendered); }, 1);
+        s.run("report/render/warm", param("errors", errors), errors, [&] { return render_errors(source, rendered); });
+    }
+}
@@ -1,112 +1,948 @@
 #include "allocation_registry.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <iterator>
+#include <mutex>
+#include <optional>
 #include <type_traits>
+#include <utility>
 
 #include "ansi_color.hpp"
-#include "load_file.hpp"
-#include "pad_with.hpp"
-#include "partition_data.hpp"
+#include "crash_dump.hpp"
+#include "event_log.hpp"
 
 namespace suiveur {
-    void allocation_registry::record_allocation(void* addr, const std::size_t type, const std::size_t line, const fs::path file) {
-        auto& keys = get().registry_keys;
-        if(keys.count(addr) > 0) {
-            auto& errors = get().errors;
-            auto& value = keys.at(addr);
-            errors.emplace_back(value, data_location{ line, file }, error_key::error_type::previously_tracked);
-        }
-        keys.emplace(addr, allocation_key { addr, type, line, file });
-    }
-
-    bool allocation_registry::record_deletion(void* addr, const std::size_t type, const std::size_t line, const fs::path file) {
-        auto& keys = get().registry_keys;
-        auto& deleted = get().deleted_keys;
-        bool return_value = false;
-
-        if(auto it = keys.find(addr); it != keys.end()) {
-            return_value = true;
-            auto& iter_value = it->second;
-            iter_value.deletion_point = data_location{ line, file };
-            if(iter_value.type_hash != type) {
-                auto& errors = get().errors;
-                errors.emplace_back(iter_value, data_location{ line, file }, error_key::error_type::type_pun, type);
-                return_value = false;
+    struct thread_buffer_handle {
+        allocation_registry::thread_buffer* buffer = nullptr;
+
+        ~thread_buffer_handle() {
+            if(buffer and allocation_registry::global_registry) {
+                [[maybe_unused]] const reentrancy_guard reentrancy {};
+                {
+                    std::lock_guard guard { buffer->lock };
+                    allocation_registry::flush(*buffer);
+                }
+                std::lock_guard guard { allocation_registry::global_registry->buffers_lock };
+                buffer->in_use = false;
+            }
+        }
+    };
+
+    static thread_local thread_buffer_handle local_handle {};
+
+    /* A pointer taken out of the registry by the macros, on its way to operator delete. */
+    [[maybe_unused]] static thread_local const void* handed_back = nullptr;
+
+    static bool hand_back([[maybe_unused]] const void* addr) {
+#ifdef SUIVEUR_TRACK_GLOBAL_NEW
+        handed_back = addr;
+#endif
+        return true;
+    }
+
+    /* Read before main, calls from static initializers that run earlier see the built in state. */
+    const bool allocation_registry::tracking_configured = [] {
+        tracking_switch::configure_from_environment();
+#ifdef SUIVEUR_CRASH_DUMP
+        crash_dump::configure_from_environment();
+#endif
+        if(not allocation_registry::global_registry) tracking_switch::forget_held();
+        return true;
+    }();
+
+    /* While an event log is open, calls are streamed to it instead of being tracked here. */
+    static bool logged([[maybe_unused]] const event_op op, [[maybe_unused]] const void* addr,
+                       [[maybe_unused]] const void* type, [[maybe_unused]] const void* site,
+                       [[maybe_unused]] const std::size_t size = 0, [[maybe_unused]] const std::size_t count = 0,
+                       [[maybe_unused]] const allocation_kind kind = allocation_kind::scalar) {
+#ifdef SUIVEUR_EVENT_LOG
+        if(auto* log = event_log::active()) {
+            event_record record {};
+            record.op = op;
+            record.address = reinterpret_cast<std::uintptr_t>(addr);
+            record.type = reinterpret_cast<std::uintptr_t>(type);
+            record.site = reinterpret_cast<std::uintptr_t>(site);
+            record.size = size;
+            record.count = count;
+            record.kind = static_cast<std::uint8_t>(kind);
+            log->push(record);
+            return true;
+        }
+#endif
+        return false;
+    }
+
+    /* Parent directory and file name, as reports print them. */
+    static std::string_view short_path(const allocation_registry::data_location& loc) {
+        if(not loc.site) return {};
+        const std::string_view file { loc.site->file };
+        auto slash = file.find_last_of("/\\");
+        if(slash == std::string_view::npos or slash == 0) return file;
+        slash = file.find_last_of("/\\", slash - 1);
+        return slash == std::string_view::npos ? file : file.substr(slash + 1);
+    }
+
+    struct occurrences {
+        const allocation_registry::error_record& record;
+    };
+
+    static report_buffer& operator<<(report_buffer& out, const occurrences& seen) {
+        if(seen.record.count < 2) return out;
+        out << " (" << seen.record.count << " times";
+        if(seen.record.bytes > 0) out << ", " << seen.record.bytes << " bytes";
+        return out << ')';
+    }
+
+    using leak_record = allocation_registry::leak_record;
+
+    static void list_allocation_point(report_buffer& out, const allocation_registry::allocation_key& key) {
+        if(key.interposed) {
+            out << "---> " << (key.kind == allocation_kind::array ? "operator new[]" : "operator new")
+                << " called from " << key.caller;
+        }
+        else out << "---> " << short_path(key.allocation_point) << ':' << key.allocation_point.line();
+    }
+
+    /* Frames innermost first, leaving out those of the library calls that recorded them. */
+    static std::vector<std::string> stack_names(stack_store& stacks, const stack_id id) {
+        std::vector<std::string> names;
+        if constexpr(stack_depth > 0) {
+            for(const void* frame : stacks.frames(id)) {
+                auto sym = stacks.symbolize(frame);
+                if(names.empty() and sym.internal) continue;
+                names.push_back(std::move(sym.name));
+            }
+        }
+        return names;
+    }
+
+    static void list_stack(report_buffer& out, stack_store& stacks, const stack_id id,
+                           const report_buffer::repeat& indent, const std::string_view what = {}) {
+        const auto names = stack_names(stacks, id);
+        if(names.empty()) return;
+        out << indent << " = ";
+        if(not what.empty()) out << what << ", ";
+        out << "called from:\n";
+        for(std::size_t idx = 0; idx < names.size(); ++idx) {
+            out << indent << "     #" << idx << ' ' << std::string_view { names[idx] } << '\n';
+        }
+    }
+
+    static void list_unsampled(report_buffer& out, stack_store& stacks, const std::vector<leak_record>& leaks) {
+        std::size_t free_count = 0;
+        std::size_t array_count = 0;
+        std::size_t array_bytes = 0;
+        for(auto& leak : leaks) free_count += leak.pointers;
+
+        out << ansi::red << "error" << ansi::reset << ": " << free_count
+            << " unfreed pointer" << ((free_count == 1) ? "" : "s") << " at:\n";
+        out << ansi::red;
+        for(auto& leak : leaks) {
+            const auto& key = leak.first;
+            list_allocation_point(out, key);
+            if(key.interposed) {
+                out << " [";
+                if(leak.pointers > 1) out << leak.pointers << " pointers, ";
+                out << leak.bytes << " bytes]";
+            }
+            else if(key.kind == allocation_kind::array) {
+                out << " [";
+                if(leak.pointers > 1) out << leak.pointers << " arrays, ";
+                out << leak.count << " x " << key.type->name << ", " << leak.bytes << " bytes]";
+                array_count += leak.pointers;
+                array_bytes += leak.bytes;
+            }
+            else if(leak.pointers > 1) {
+                out << " [" << leak.pointers << " x " << key.type->name << ", " << leak.bytes << " bytes]";
+            }
+            out << '\n';
+            list_stack(out, stacks, key.allocation_point.stack, {});
+        }
+        if(array_count > 0) {
+            out << array_count << " unfreed array" << ((array_count == 1) ? "" : "s")
+                << " totalling " << array_bytes << " bytes\n";
+        }
+        out << ansi::reset << '\n';
+    }
+
+    /* Each sample stands for the allocations expected between two samples of its size. */
+    static void list_sampled(report_buffer& out, stack_store& stacks, const std::vector<leak_record>& leaks) {
+        std::size_t samples = 0;
+        double total_count = 0;
+        double total_bytes = 0;
+        for(auto& leak : leaks) {
+            samples += leak.pointers;
+            total_count += leak.estimated_count;
+            total_bytes += leak.estimated_bytes;
+        }
+
+        out << ansi::red << "error" << ansi::reset << ": ~" << std::size_t(total_count + 0.5)
+            << " unfreed pointers (~" << std::size_t(total_bytes + 0.5) << " bytes), estimated from "
+            << samples << " sample" << ((samples == 1) ? "" : "s")
+            << " taken every " << sample_interval << " bytes at:\n";
+        out << ansi::red;
+        for(auto& leak : leaks) {
+            list_allocation_point(out, leak.first);
+            out << " ~" << std::size_t(leak.estimated_count + 0.5) << " x " << leak.first.type->name
+                << ", ~" << std::size_t(leak.estimated_bytes + 0.5) << " bytes ["
+                << leak.pointers << " sampled]\n";
+            list_stack(out, stacks, leak.first.allocation_point.stack, {});
+        }
+        out << ansi::reset << '\n';
+    }
+
+    /* Null is the empty key of the usage tables. */
+    static constexpr call_site unknown_site { "<unknown>", 0 };
+
+    /* Once allocations went unrecorded, an unknown pointer is taken to be one of them, unless new can't have made it. */
+    static bool skipped_allocation(const void* addr) {
+        return (tracking_switch::flags() & tracking_switch::skipped) and not static_or_stack_address(addr);
+    }
+
+    void allocation_registry::record_allocation(void* addr, const type_id type, const call_site* site, const std::size_t size,
+                                                const allocation_kind kind, const std::size_t count) {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        if(not addr) return;
+        if(not recording()) return;
+        if(logged(event_op::allocation, addr, type, site, size, count, kind)) return log_allocation(addr, type, kind, false);
+        if constexpr(sample_interval > 0) {
+            if(not should_sample(size)) return get().unsampled.insert(addr);
+        }
+        const data_location point { site, stack_depth > 0 ? get().stacks.capture() : 0 };
+        auto& buffer = local_buffer();
+        std::lock_guard guard { buffer.lock };
+        if constexpr(thread_cache_size > 0) {
+            auto [entry, inserted] = buffer.pending.try_emplace(addr);
+            if(not inserted) {
+                /* What operator new recorded for the same allocation. */
+                if(not entry->value.interposed) {
+                    record_error(buffer, error_key { entry->value, point, error_key::error_type::previously_tracked });
+                }
+                account(buffer, entry->value, false);
             }
+#ifdef SUIVEUR_TRACK_GLOBAL_NEW
             else {
-                deleted.push_back(iter_value);
-                keys.erase(addr);
+                /* Flushed already, it would outlive the typed key once another thread deletes the pointer. */
+                auto& s = shard_for(addr);
+                std::lock_guard shard_guard { s.lock };
+                if(auto* shared = s.keys.find(addr); shared and shared->value.interposed) {
+                    account(buffer, shared->value, false);
+                    s.keys.erase(shared);
+                }
+            }
+#endif
+            entry->value = allocation_key { addr, type, site, size, kind, count };
+            entry->value.allocation_point = point;
+            entry->value.made_in = current_generation.load(std::memory_order_relaxed);
+            entry->value.born = lifetime_clock::now();
+            account(buffer, entry->value, true);
+            if(buffer.pending.size() + buffer.deleted.size() >= thread_cache_size) flush(buffer);
+        }
+        else {
+            allocation_key key { addr, type, site, size, kind, count };
+            key.allocation_point = point;
+            key.made_in = current_generation.load(std::memory_order_relaxed);
+            key.born = lifetime_clock::now();
+            account(buffer, key, true);
+            insert_shared(buffer, std::move(key));
+        }
+    }
+
+    bool allocation_registry::record_deletion(void* addr, const type_id type, const call_site* site, const allocation_kind kind) {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        if(not addr) return false;
+        if(not recording() and not tracking_switch::watching()) return false;
+        if(logged(event_op::deletion, addr, type, site, 0, 0, kind)) return log_deletion(addr, type, kind, false).value_or(false);
+        const data_location loc { site, stack_depth > 0 ? get().stacks.capture() : 0 };
+        auto& buffer = local_buffer();
+        std::unique_lock guard { buffer.lock };
+        if(auto deleted = delete_tracked(buffer, addr, type, kind, loc, nullptr)) return *deleted and hand_back(addr);
+        /* Most pointers weren't sampled, they are let go before looking through other threads' buffers. */
+        if constexpr(sample_interval > 0) {
+            if(get().unsampled.erase(addr)) return true;
+        }
+        if constexpr(thread_cache_size > 0) {
+            guard.unlock();
+            const bool flushed = flush_holding(addr);
+            guard.lock();
+            if(flushed) {
+                if(auto deleted = delete_tracked(buffer, addr, type, kind, loc, nullptr)) return *deleted and hand_back(addr);
+            }
+        }
+        return false;
+    }
+
+    bool allocation_registry::safe_deletion(void* addr, const type_id type, const call_site* site, const allocation_kind kind,
+                                            allocation_key* erased) {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        if(not addr) return true;
+        const bool active = recording();
+        if(not active and not tracking_switch::watching()) return true;
+        if(logged(event_op::safe_deletion, addr, type, site, 0, 0, kind)) {
+            if(auto deleted = log_deletion(addr, type, kind, true)) return *deleted;
+            return skipped_allocation(addr);
+        }
+        const data_location loc { site, stack_depth > 0 ? get().stacks.capture() : 0 };
+        auto& buffer = local_buffer();
+        std::unique_lock guard { buffer.lock };
+        if(auto deleted = delete_tracked(buffer, addr, type, kind, loc, erased)) return *deleted and hand_back(addr);
+        if constexpr(sample_interval > 0) {
+            if(get().unsampled.erase(addr)) return true;
+        }
+        if constexpr(thread_cache_size > 0) {
+            guard.unlock();
+            const bool flushed = flush_holding(addr);
+            guard.lock();
+            if(flushed) {
+                if(auto deleted = delete_tracked(buffer, addr, type, kind, loc, erased)) return *deleted and hand_back(addr);
+            }
+        }
+        if(not active) return skipped_allocation(addr);
+
+        if(auto deleted_key = find_deleted(addr, type)) {
+            record_error(buffer, error_key { *deleted_key, loc, error_key::error_type::previously_deleted });
+        }
+        else if(skipped_allocation(addr)) {
+            return true;
+        }
+        else {
+            allocation_key key { type };
+            record_error(buffer, error_key { key, loc, error_key::error_type::untracked });
+        }
+        return false;
+    }
+
+    std::optional<bool> allocation_registry::delete_tracked(thread_buffer& buffer, void* addr, const type_id type,
+                                                            const allocation_kind kind, const data_location& loc,
+                                                            allocation_key* erased) {
+        auto erase_key = [&](auto& table, auto* entry) -> bool {
+            auto& value = entry->value;
+            value.deletion_point = loc;
+            if(not value.interposed and not same_type(value.type, type)) {
+                record_error(buffer, error_key { value, loc, error_key::error_type::type_pun, type });
+                return false;
+            }
+            if(value.kind != kind) {
+                record_error(buffer, error_key { value, loc, error_key::error_type::mismatched_delete });
+                return false;
+            }
+            account(buffer, value, false);
+            if(value.interposed) value.type = type;
+            if(erased) *erased = value;
+            if(&table == &buffer.pending) buffer.stage_deletion(std::move(value));
+            else shard_for(addr).deleted.push(std::move(value));
+            table.erase(entry);
+            return true;
+        };
+
+        if constexpr(thread_cache_size > 0) {
+            if(auto* entry = buffer.pending.find(addr)) return erase_key(buffer.pending, entry);
+        }
+        auto& s = shard_for(addr);
+        std::lock_guard guard { s.lock };
+        if(auto* entry = s.keys.find(addr)) return erase_key(s.keys, entry);
+        return std::nullopt;
+    }
+
+    void allocation_registry::insert_shared(thread_buffer& buffer, allocation_key key) {
+        auto& s = shard_for(key.data);
+        std::lock_guard guard { s.lock };
+        auto [entry, inserted] = s.keys.try_emplace(key.data);
+        if(not inserted) {
+            /* Both stand for the same allocation, the one REGISTER_ALLOC made knows its type. */
+            if(key.interposed and not entry->value.interposed) return account(buffer, key, false);
+            if(not entry->value.interposed) {
+                record_error(buffer, error_key { entry->value, key.allocation_point, error_key::error_type::previously_tracked });
             }
+            account(buffer, entry->value, false);
         }
-        return return_value;
+        entry->value = std::move(key);
     }
 
-    bool allocation_registry::safe_deletion(void* addr, const std::size_t type, const std::size_t line, const fs::path file) {
-        auto& keys = get().registry_keys;
-        auto& deleted = get().deleted_keys;
+    void allocation_registry::log_allocation(void* addr, const type_id type, const allocation_kind kind, const bool interposed) {
+        auto& s = shard_for(addr);
+        std::lock_guard guard { s.lock };
+        s.logged.try_emplace(addr).first->value = logged_pointer { type, kind, interposed };
+    }
+
+    /* Checked deletions only free pointers the analyzer won't report, as SAFE_DELETE does when tracking in process. */
+    std::optional<bool> allocation_registry::log_deletion(void* addr, const type_id type, const allocation_kind kind, const bool checked) {
+        auto& s = shard_for(addr);
+        std::lock_guard guard { s.lock };
+        auto* entry = s.logged.find(addr);
+        if(not entry) return std::nullopt;
+        const auto& ptr = entry->value;
+        if(checked and ((not ptr.interposed and not same_type(ptr.type, type)) or ptr.kind != kind)) return false;
+        s.logged.erase(entry);
+        return true;
+    }
+
+    void allocation_registry::account(thread_buffer& buffer, const allocation_key& key, const bool allocated) {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        std::uint64_t count = 1;
+        std::uint64_t bytes = key.size;
+        if constexpr(sample_interval > 0) {
+            const double weight = sample_weight(key.size);
+            count = static_cast<std::uint64_t>(std::llround(weight));
+            bytes = static_cast<std::uint64_t>(std::llround(weight * double(key.size)));
+        }
+        const auto sign = allocated ? std::int64_t { 1 } : std::int64_t { -1 };
+        const std::uint64_t lifetime = allocated ? 0 : lifetime_clock::to_ns(lifetime_clock::now() - key.born);
 
-        if(auto it = keys.find(addr); it != keys.end()) {
-            return allocation_registry::record_deletion(addr, type, line, file);
+        auto& reg = get();
+        reg.live_count.fetch_add(sign * std::int64_t(count), relaxed);
+        if(allocated) {
+            reg.total_count.fetch_add(count, relaxed);
+            reg.total_bytes.fetch_add(bytes, relaxed);
+            const auto live = reg.live_bytes.fetch_add(std::int64_t(bytes), relaxed) + std::int64_t(bytes);
+            auto peak = reg.peak_bytes.load(relaxed);
+            while(live > std::int64_t(peak) and not reg.peak_bytes.compare_exchange_weak(peak, std::uint64_t(live), relaxed)) {}
         }
         else {
-            auto deleted_key = allocation_registry::find_deleted(addr, type);
-            auto& errors = get().errors;
-            if(deleted_key == deleted.end()) {
-                allocation_key key { type };
-                errors.emplace_back(key, data_location{ line, file }, error_key::error_type::untracked);
+            reg.live_bytes.fetch_sub(std::int64_t(bytes), relaxed);
+            reg.total_deletions.fetch_add(count, relaxed);
+        }
+
+        const void* site = key.interposed ? key.caller : static_cast<const void*>(key.allocation_point.site);
+        if(not site) site = &unknown_site;
+        for(auto* entry : { buffer.types.try_emplace(key.type).first, buffer.sites.try_emplace(site).first }) {
+            auto& use = entry->value;
+            use.live_count += sign * std::int64_t(count);
+            use.live_bytes += sign * std::int64_t(bytes);
+            if(allocated) {
+                use.total_count += count;
+                use.total_bytes += bytes;
+            }
+            else use.lifetimes.add(lifetime, count);
+            use.interposed = key.interposed;
+        }
+    }
+
+    void allocation_registry::reset_counters() {
+        auto& reg = get();
+        for(auto* counter : { &reg.live_count, &reg.live_bytes }) counter->store(0, std::memory_order_relaxed);
+        for(auto* counter : { &reg.peak_bytes, &reg.total_count, &reg.total_bytes, &reg.total_deletions }) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void allocation_registry::flush(thread_buffer& buffer) {
+        for(auto& key : buffer.deleted) {
+            auto& s = shard_for(key.data);
+            std::lock_guard guard { s.lock };
+            s.deleted.push(std::move(key));
+        }
+        buffer.clear_deleted();
+        for(auto& [addr, key] : buffer.pending) insert_shared(buffer, std::move(key));
+        buffer.pending.clear();
+    }
+
+    /* Only buffers still holding the pointer, allocated or deleted, are flushed. */
+    bool allocation_registry::flush_holding(void* addr) {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        bool flushed = false;
+        if constexpr(thread_cache_size > 0) {
+            auto& reg = get();
+            std::lock_guard guard { reg.buffers_lock };
+            for(auto& buffer : reg.thread_buffers) {
+                /* Threads flush their buffer when they exit. */
+                if(not buffer->in_use) continue;
+                std::lock_guard buffer_guard { buffer->lock };
+                if(buffer->pending.find(addr) or buffer->staged_deletion(addr)) {
+                    flush(*buffer);
+                    flushed = true;
+                }
+            }
+        }
+        return flushed;
+    }
+
+    void allocation_registry::flush_all() {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        if constexpr(thread_cache_size > 0) {
+            auto& reg = get();
+            std::lock_guard guard { reg.buffers_lock };
+            for(auto& buffer : reg.thread_buffers) {
+                std::lock_guard buffer_guard { buffer->lock };
+                flush(*buffer);
+            }
+        }
+    }
+
+    void allocation_registry::record_global_allocation(void* addr, const std::size_t size, const allocation_kind kind,
+                                                       const void* caller) noexcept {
+        if(reentrancy_guard::active or shut_down or not addr) return;
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        try {
+            if(not recording()) return;
+            if(logged(event_op::global_allocation, addr, nullptr, caller, size, 0, kind)) return log_allocation(addr, nullptr, kind, true);
+            if constexpr(sample_interval > 0) {
+                if(not should_sample(size)) return get().unsampled.insert(addr);
+            }
+            /* Skips operator new. */
+            const stack_id stack = stack_depth > 0 ? get().stacks.capture(1) : 0;
+            auto& buffer = local_buffer();
+            std::lock_guard buffer_guard { buffer.lock };
+            auto record = [&](key_table& table) {
+                auto [entry, inserted] = table.try_emplace(addr);
+                if(not inserted) account(buffer, entry->value, false);
+                auto& key = entry->value;
+                key = allocation_key { addr, cttype_id<void>, nullptr, size, kind };
+                key.caller = caller;
+                key.allocation_point.stack = stack;
+                key.made_in = current_generation.load(std::memory_order_relaxed);
+                key.born = lifetime_clock::now();
+                key.interposed = true;
+                account(buffer, key, true);
+            };
+            /* Staged like the keys REGISTER_ALLOC makes, so one replaces the other before either is shared. */
+            if constexpr(thread_cache_size > 0) {
+                record(buffer.pending);
+                if(buffer.pending.size() + buffer.deleted.size() >= thread_cache_size) flush(buffer);
+            }
+            else {
+                auto& s = shard_for(addr);
+                std::lock_guard guard { s.lock };
+                record(s.keys);
+            }
+        }
+        catch(...) {}
+    }
+
+    void allocation_registry::record_global_deletion(void* addr, const allocation_kind kind) noexcept {
+        if(reentrancy_guard::active or shut_down or not tracking_switch::watching()) return;
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        try {
+            if(logged(event_op::global_deletion, addr, nullptr, nullptr, 0, 0, kind)) {
+                log_deletion(addr, nullptr, kind, false);
+                return;
+            }
+            auto& buffer = local_buffer();
+            std::unique_lock buffer_guard { buffer.lock };
+            if(delete_global(buffer, addr)) return;
+            buffer_guard.unlock();
+            if constexpr(sample_interval > 0) {
+                if(get().unsampled.erase(addr)) return;
+            }
+            if constexpr(thread_cache_size > 0) {
+                if(std::exchange(handed_back, nullptr) == addr) return;
+                /* Allocated on another thread, and still staged there. */
+                if(flush_holding(addr)) {
+                    buffer_guard.lock();
+                    delete_global(buffer, addr);
+                }
+            }
+        }
+        catch(...) {}
+    }
+
+    bool allocation_registry::delete_global(thread_buffer& buffer, void* addr) {
+        if constexpr(thread_cache_size > 0) {
+            if(auto* entry = buffer.pending.find(addr)) {
+                account(buffer, entry->value, false);
+                if(not entry->value.interposed) buffer.stage_deletion(std::move(entry->value));
+                buffer.pending.erase(entry);
+                return true;
+            }
+        }
+        auto& s = shard_for(addr);
+        std::lock_guard guard { s.lock };
+        if(auto* entry = s.keys.find(addr)) {
+            account(buffer, entry->value, false);
+            if(not entry->value.interposed) s.deleted.push(std::move(entry->value));
+            s.keys.erase(entry);
+            return true;
+        }
+        return false;
+    }
+
+    /* Objects living in memory released in bulk, such as an arena, whose destructor never ran. */
+    void allocation_registry::record_undestroyed(void* addr, const type_id type, const call_site* created, const std::size_t size,
+                                                 const call_site* released) {
+        if(not tracking_switch::enabled()) return;
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        auto& buffer = local_buffer();
+        std::lock_guard guard { buffer.lock };
+        record_error(buffer, error_key { allocation_key { addr, type, created, size }, data_location { released },
+                                         error_key::error_type::not_destroyed });
+    }
+
+    void allocation_registry::restore_error(const error_key& error, const std::size_t count, const std::size_t bytes) {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        auto& buffer = local_buffer();
+        std::lock_guard guard { buffer.lock };
+        record_error(buffer, error, count, bytes);
+    }
+
+    /* Addresses deleted before tracking went dormant may have been handed out again unseen, the first call after it resumes forgets them. */
+    bool allocation_registry::recording() {
+        const unsigned flags = tracking_switch::flags();
+        if(not (flags & tracking_switch::recording)) return false;
+        if((flags & tracking_switch::stale) and tracking_switch::take_stale()) {
+            flush_all();
+            for(auto& s : get().shards) {
+                std::lock_guard guard { s.lock };
+                s.deleted = deleted_history<allocation_key> { shard_capacity(deleted_capacity), deleted_policy };
+            }
+        }
+        return true;
+    }
+
+    std::optional<allocation_registry::allocation_key> allocation_registry::find_deleted(void* addr, const type_id type) {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        auto& s = shard_for(addr);
+        std::lock_guard guard { s.lock };
+        if(auto* key = s.deleted.find(addr, type->hash)) return *key;
+        return std::nullopt;
+    }
+
+    void allocation_registry::configure_deleted_history(const std::size_t capacity, const eviction_policy policy) {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        deleted_capacity = capacity;
+        deleted_policy = policy;
+        for(auto& s : get().shards) {
+            std::lock_guard guard { s.lock };
+            s.deleted = deleted_history<allocation_key> { shard_capacity(capacity), policy };
+        }
+    }
+
+    void allocation_registry::configure_quarantine(const std::size_t capacity, const bool protect) {
+        quarantine_protect.store(protect, std::memory_order_relaxed);
+        quarantine_capacity.store(capacity, std::memory_order_relaxed);
+        if(capacity == 0) drain_quarantine();
+    }
+
+    /* Oldest entries are let go first, until what is left fits in the capacity. */
+    void allocation_registry::quarantine(const allocation_key& key, const std::size_t size, const release_function release) {
+#ifdef SUIVEUR_TRACK_GLOBAL_NEW
+        /* What operator delete would have cleared, the release itself goes unseen. */
+        record_global_deletion(key.data, key.kind);
+#endif
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        poison(key.data, size);
+        const bool protect = quarantine_protect.load(std::memory_order_relaxed) and protect_pages(key.data, size);
+        const auto capacity = quarantine_capacity.load(std::memory_order_relaxed);
+        std::vector<quarantined> evicted;
+        {
+            auto& reg = get();
+            std::lock_guard guard { reg.quarantine_lock };
+            reg.quarantined_list.push_back(quarantined { key, size, release, protect });
+            reg.quarantined_bytes += size;
+            while(reg.quarantined_bytes > capacity and not reg.quarantined_list.empty()) {
+                reg.quarantined_bytes -= reg.quarantined_list.front().size;
+                evicted.push_back(std::move(reg.quarantined_list.front()));
+                reg.quarantined_list.pop_front();
+            }
+        }
+        for(auto& entry : evicted) release_quarantined(entry);
+    }
+
+    void allocation_registry::drain_quarantine() {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        std::deque<quarantined> evicted;
+        {
+            auto& reg = get();
+            std::lock_guard guard { reg.quarantine_lock };
+            evicted.swap(reg.quarantined_list);
+            reg.quarantined_bytes = 0;
+        }
+        for(auto& entry : evicted) release_quarantined(entry);
+    }
+
+    void allocation_registry::release_quarantined(const quarantined& entry) {
+        if(entry.protected_pages) unprotect_pages(entry.key.data, entry.size);
+        if(find_unpoisoned(entry.key.data, entry.size) != entry.size) {
+            auto& buffer = local_buffer();
+            std::lock_guard guard { buffer.lock };
+            record_error(buffer, error_key { entry.key, entry.key.deletion_point, error_key::error_type::written_after_free });
+        }
+        entry.release(entry.key.data);
+    }
+
+    void allocation_registry::set_report_sink(report_sink sink) {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        auto& reg = get();
+        std::lock_guard guard { reg.report_lock };
+        if(not reg.sarif_results.empty()) reg.end_sarif_run();
+        reg.close_report_file();
+        reg.sink = std::move(sink);
+    }
+
+    void allocation_registry::set_report_format(const report_format format) {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        auto& reg = get();
+        std::lock_guard guard { reg.report_lock };
+        if(format != reg.format and not reg.sarif_results.empty()) reg.end_sarif_run();
+        reg.format = format;
+    }
+
+    allocation_stats allocation_registry::stats() {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        constexpr auto relaxed = std::memory_order_relaxed;
+        auto clamp = [](const std::int64_t value) { return static_cast<std::size_t>(std::max<std::int64_t>(value, 0)); };
+        auto& reg = get();
+
+        allocation_stats out {};
+        out.live_count = clamp(reg.live_count.load(relaxed));
+        out.live_bytes = clamp(reg.live_bytes.load(relaxed));
+        out.peak_bytes = reg.peak_bytes.load(relaxed);
+        out.total_count = reg.total_count.load(relaxed);
+        out.total_bytes = reg.total_bytes.load(relaxed);
+        out.total_deletions = reg.total_deletions.load(relaxed);
+        out.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - reg.started).count();
+        if(out.elapsed_seconds > 0) {
+            out.allocation_rate = double(out.total_count) / out.elapsed_seconds;
+            out.byte_rate = double(out.total_bytes) / out.elapsed_seconds;
+        }
+
+        usage_table types, sites;
+        {
+            std::lock_guard guard { reg.buffers_lock };
+            for(auto& buffer : reg.thread_buffers) {
+                std::lock_guard buffer_guard { buffer->lock };
+                for(auto [from, into] : { std::pair { &buffer->types, &types }, std::pair { &buffer->sites, &sites } }) {
+                    for(auto& [key, use] : *from) {
+                        auto& total = into->try_emplace(key).first->value;
+                        total.live_count += use.live_count;
+                        total.live_bytes += use.live_bytes;
+                        total.total_count += use.total_count;
+                        total.total_bytes += use.total_bytes;
+                        total.lifetimes.merge(use.lifetimes);
+                        total.interposed = use.interposed;
+                    }
+                }
             }
+        }
+
+        auto fill = [&](usage_stats& into, const usage& use) {
+            into.live_count = clamp(use.live_count);
+            into.live_bytes = clamp(use.live_bytes);
+            into.total_count = use.total_count;
+            into.total_bytes = use.total_bytes;
+            into.lifetimes = use.lifetimes;
+        };
+        auto by_live_bytes = [](const usage_stats& lhs, const usage_stats& rhs) { return lhs.live_bytes > rhs.live_bytes; };
+
+        out.types.reserve(types.size());
+        for(auto& [key, use] : types) {
+            auto& type = out.types.emplace_back();
+            fill(type, use);
+            type.type = static_cast<type_id>(key)->name;
+            out.lifetimes.merge(use.lifetimes);
+        }
+        out.sites.reserve(sites.size());
+        for(auto& [key, use] : sites) {
+            auto& site = out.sites.emplace_back();
+            fill(site, use);
+            if(use.interposed and key != &unknown_site) site.caller = key;
             else {
-                errors.emplace_back(*deleted_key, data_location{ line, file }, error_key::error_type::previously_deleted);
+                site.file = static_cast<const call_site*>(key)->file;
+                site.line = static_cast<const call_site*>(key)->line;
+            }
+        }
+        std::sort(out.types.begin(), out.types.end(), by_live_bytes);
+        std::sort(out.sites.begin(), out.sites.end(), by_live_bytes);
+        return out;
+    }
+
+    /* Only the oldest count pointers are kept while walking the shards, youngest on top of the heap. */
+    std::vector<allocation_registry::live_allocation> allocation_registry::oldest(const std::size_t count) {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        std::vector<live_allocation> found;
+        if(count == 0) return found;
+        flush_all();
+        auto younger = [](const live_allocation& lhs, const live_allocation& rhs) { return lhs.key.born < rhs.key.born; };
+        found.reserve(count);
+        for(auto& s : get().shards) {
+            std::lock_guard guard { s.lock };
+            for(auto& [addr, key] : s.keys) {
+                if(found.size() < count) {
+                    found.push_back(live_allocation { key });
+                    std::push_heap(found.begin(), found.end(), younger);
+                }
+                else if(key.born < found.front().key.born) {
+                    std::pop_heap(found.begin(), found.end(), younger);
+                    found.back() = live_allocation { key };
+                    std::push_heap(found.begin(), found.end(), younger);
+                }
+            }
+        }
+        std::sort_heap(found.begin(), found.end(), younger);
+        const auto now = lifetime_clock::now();
+        for(auto& live : found) live.age_ns = lifetime_clock::to_ns(now - live.key.born);
+        return found;
+    }
+
+    allocation_registry::thread_buffer& allocation_registry::local_buffer() {
+        auto& handle = local_handle;
+        if(not handle.buffer) {
+            auto& reg = get();
+            std::lock_guard guard { reg.buffers_lock };
+            for(auto& buffer : reg.thread_buffers) {
+                if(not buffer->in_use) {
+                    buffer->in_use = true;
+                    handle.buffer = buffer.get();
+                    break;
+                }
+            }
+            if(not handle.buffer) {
+                handle.buffer = reg.thread_buffers.emplace_back(std::make_unique<thread_buffer>()).get();
             }
-            return false;
         }
+        return *handle.buffer;
     }
 
-    allocation_registry::deleted_iter allocation_registry::find_deleted(void* addr, const std::size_t type) {
-        auto& deleted = get().deleted_keys;
-        return std::find_if(
-                deleted.begin(), deleted.end(),
-                [&](allocation_key& mem) -> bool { return (mem.data == addr) && (mem.type_hash == type); }
-        );
+    /* Repeats of an error at the same sites only bump its count, the table grows with distinct sites. */
+    void allocation_registry::record_error(thread_buffer& buffer, const error_key& error, const std::size_t count,
+                                           const std::size_t bytes) {
+        const error_id id {
+            error.loc.site, error.key.allocation_point.site, error.key.deletion_point.site,
+            error.key.caller, error.key.type, error.type, error.err, error.loc.stack
+        };
+        const auto seen = get().error_sequence.fetch_add(1, std::memory_order_relaxed);
+        auto [entry, inserted] = buffer.errors.try_emplace(id);
+        auto& record = entry->value;
+        if(inserted) {
+            record.first = error;
+            record.first_seen = seen;
+        }
+        record.count += count;
+        record.bytes += bytes;
+        record.last_seen = seen;
+    }
+
+    std::vector<allocation_registry::error_record> allocation_registry::collect_errors() {
+        auto& reg = get();
+        error_table merged;
+        {
+            std::lock_guard guard { reg.buffers_lock };
+            for(auto& buffer : reg.thread_buffers) {
+                std::lock_guard buffer_guard { buffer->lock };
+                for(auto& [id, record] : buffer->errors) {
+                    auto [entry, inserted] = merged.try_emplace(id);
+                    auto& total = entry->value;
+                    if(inserted or record.first_seen < total.first_seen) {
+                        total.first = record.first;
+                        total.first_seen = record.first_seen;
+                    }
+                    total.count += record.count;
+                    total.bytes += record.bytes;
+                    total.last_seen = std::max(total.last_seen, record.last_seen);
+                }
+            }
+        }
+
+        std::vector<error_record> errors;
+        errors.reserve(merged.size());
+        for(auto& [id, record] : merged) errors.push_back(record);
+        std::sort(errors.begin(), errors.end(), [](const error_record& lhs, const error_record& rhs) {
+            return lhs.first_seen < rhs.first_seen;
+        });
+        return errors;
+    }
+
+    void allocation_registry::clear_buffers(const bool keep_pending) {
+        auto& reg = get();
+        std::lock_guard guard { reg.buffers_lock };
+        for(auto& buffer : reg.thread_buffers) {
+            std::lock_guard buffer_guard { buffer->lock };
+            buffer->errors.clear();
+            buffer->clear_deleted();
+            if(not keep_pending) {
+                buffer->pending = key_table {};
+                buffer->types = usage_table {};
+                buffer->sites = usage_table {};
+            }
+        }
     }
 
     allocation_registry& allocation_registry::get() {
-        static allocation_registry_handler reg_handler {};
-        allocation_registry*& reg = global_registry;
-        if(not reg) reg = new allocation_registry {};
-        reg_handler.global_registry_ptr = &reg;
-        return *reg;
+        static allocation_registry_handler reg_handler = [] {
+            global_registry = new allocation_registry {};
+            if(const char* name = std::getenv("SUIVEUR_REPORT_FORMAT")) {
+                if(const auto format = parse_report_format(name)) global_registry->format = *format;
+            }
+            if(const char* path = std::getenv("SUIVEUR_REPORT_FILE")) {
+                if(std::FILE* file = std::fopen(path, "w")) {
+                    global_registry->report_file = file;
+                    global_registry->sink = report_sink::to_file(file);
+                }
+            }
+            return allocation_registry_handler { &global_registry };
+        }();
+        return *global_registry;
     }
 
     void allocation_registry::erase() {
-        allocation_registry*& reg = global_registry;
-        delete reg;
-        reg = nullptr;
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        if(logged(event_op::reset, nullptr, nullptr, nullptr)) {
+            for(auto& s : get().shards) {
+                std::lock_guard guard { s.lock };
+                s.logged = flat_table<void*, logged_pointer> {};
+            }
+            return;
+        }
+#ifdef ENABLE_MEMORY_REGISTRY
+        drain_quarantine();
+        print_report();
+#endif
+        clear_buffers(false);
+        reset_counters();
+        get().unsampled.clear();
+        for(auto& s : get().shards) {
+            std::lock_guard guard { s.lock };
+            s.keys = key_table {};
+            s.deleted = deleted_history<allocation_key> { shard_capacity(deleted_capacity), deleted_policy };
+        }
+        tracking_switch::forget_held();
+        tracking_switch::forget_skipped();
     }
 
     void allocation_registry::pass() {
-        allocation_registry*& reg = global_registry;
-        auto* new_reg = new allocation_registry {};
-        new_reg->registry_keys = reg->registry_keys;
-        reg->registry_keys.clear();
-        delete reg;
-        reg = new_reg;
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        if(logged(event_op::pass, nullptr, nullptr, nullptr)) return;
+#ifdef ENABLE_MEMORY_REGISTRY
+        print_errors();
+#endif
+        clear_buffers(true);
+        for(auto& s : get().shards) {
+            std::lock_guard guard { s.lock };
+            s.deleted = deleted_history<allocation_key> { shard_capacity(deleted_capacity), deleted_policy };
+        }
     }
 
-    void allocation_registry::print_errors() {
+    /* The site of the earlier call an error refers to, and what happened there. */
+    struct related_site {
+        const allocation_registry::data_location* loc = nullptr;
+        std::string_view what;
+    };
+
+    static related_site related_to(const allocation_registry::error_key& error) {
         using error_t = allocation_registry::error_key::error_type;
-        auto& errors { get().errors };
-        auto& types { type_names::get().names };
-        std::map<fs::path, std::unique_ptr<std::string>> file_data;
-        std::map<fs::path, std::vector<std::string_view>> file_lines;
+        switch(error.err) {
+            case error_t::previously_tracked: return { &error.key.allocation_point, "initial tracking here" };
+            case error_t::previously_deleted: return { &error.key.deletion_point, "initial deletion here" };
+            case error_t::type_pun:           return { &error.key.allocation_point, "allocated here" };
+            case error_t::mismatched_delete:
+                if(error.key.allocation_point.site) return { &error.key.allocation_point, "allocated here" };
+                break;
+            case error_t::written_after_free:
+                if(error.key.allocation_point.site) return { &error.key.allocation_point, "allocated here" };
+                break;
+            case error_t::not_destroyed:      return { &error.key.allocation_point, "created here" };
+            case error_t::untracked: break;
+        }
+        return {};
+    }
 
-        auto load_file = [&](const fs::path& filepath) {
-            if(file_data.count(filepath) == 0) {
-                file_data.emplace(filepath, std::make_unique<std::string>());
-                suiveur::load_file(filepath, *file_data[filepath]);
-                file_lines.emplace(filepath, partition_data(*file_data[filepath]));
-            }
+    static void list_errors(report_buffer& out, source_cache& sources, stack_store& stacks,
+                            const std::vector<allocation_registry::error_record>& errors) {
+        using error_t = allocation_registry::error_key::error_type;
+        auto source_line = [&](const allocation_registry::data_location& loc) {
+            return sources.line(loc.site ? loc.site->file : nullptr, loc.line() - 1);
         };
         auto get_spaces = [](const std::string_view& sv) -> std::size_t {
             std::size_t idx = 0;
@@ -116,159 +952,612 @@ namespace suiveur {
             }
             return 0;
         };
-        if(errors.empty()) return;
-
-        std::cout << ansi::red << "allocation errors found: \n" << ansi::reset;
+        out << ansi::red << "allocation errors found: \n" << ansi::reset;
 
-        for(auto& error : errors) {
-            const auto err_path { error.loc.filename };
-            const auto path_name { err_path.string() };
-            const auto on_line = error.loc.line - 1;
-            auto padding { pad_with(on_line + 1) };
+        for(auto& record : errors) {
+            const auto& error = record.first;
+            const auto on_line = error.loc.line() - 1;
+            const auto related = related_to(error);
+            const report_buffer::repeat padding {
+                std::max(report_buffer::digits(on_line + 1),
+                         related.loc and related.loc->site ? report_buffer::digits(related.loc->line()) : 0)
+            };
+            const report_buffer::repeat err_pad { padding.count - report_buffer::digits(on_line + 1) };
+            const auto print_path { short_path(error.loc) };
 
-            const std::string print_path = (err_path.parent_path().filename() / err_path.filename()).string();
-
-            fs::path decl_path;
-            std::string decl_pad;
+            std::string_view decl_text;
+            report_buffer::repeat decl_pad;
             std::size_t decl_line;
             std::size_t decl_spaces;
 
-            load_file(err_path);
-            const auto count_spaces { get_spaces(file_lines[err_path][on_line]) };
+            const auto err_text { source_line(error.loc) };
+            const auto count_spaces { get_spaces(err_text) };
 
             switch(error.err) {
                 case error_t::previously_deleted:
                 {
-                    decl_path = error.key.deletion_point.filename;
-                    decl_line = error.key.deletion_point.line - 1;
-                    decl_pad = std::string(padding.size() - pad_with(decl_line + 1).size(), ' ' );
-                    load_file(decl_path);
-                    decl_spaces = get_spaces(file_lines[decl_path][decl_line]);
-
-                    std::cout << ansi::red << "error"
-                              << ansi::reset << ": double deletion found\n";
-                    std::cout << padding << " ---> " << print_path << ':' << on_line + 1 << ':' << '\n';
-                    std::cout << padding << " | \n";
-                    std::cout << decl_line + 1 << decl_pad << " | "
-                              << ansi::blue << file_lines[decl_path][decl_line]
-                              << ansi::reset << '\n';
-                    std::cout << padding << " | "
-                              << std::string(decl_spaces, ' ')
-                              << ansi::blue << std::string(file_lines[decl_path][decl_line].size() - decl_spaces, '-')
-                              << " initial deletion here\n" << ansi::reset;
-                    std::cout << padding << " | \n";
-
-                    std::cout << on_line + 1 << " | "
-                              << ansi::red << file_lines[err_path][on_line]
-                              << ansi::reset << '\n';
-                    std::cout << padding << " | "
-                              << std::string(count_spaces, ' ')
-                              << ansi::red << std::string(file_lines[err_path][on_line].size() - count_spaces, '^')
-                              << " second delete here\n" << ansi::reset;
-                    std::cout << padding << " | \n";
+                    decl_text = source_line(error.key.deletion_point);
+                    decl_line = error.key.deletion_point.line() - 1;
+                    decl_pad = { padding.count - report_buffer::digits(decl_line + 1) };
+                    decl_spaces = get_spaces(decl_text);
+
+                    out << ansi::red << "error"
+                        << ansi::reset << ": double deletion found" << occurrences { record } << '\n';
+                    out << padding << " ---> " << print_path << ':' << on_line + 1 << ':' << '\n';
+                    out << padding << " | \n";
+                    out << decl_line + 1 << decl_pad << " | "
+                        << ansi::blue << decl_text
+                        << ansi::reset << '\n';
+                    out << padding << " | "
+                        << report_buffer::repeat { decl_spaces, ' ' }
+                        << ansi::blue << report_buffer::repeat { decl_text.size() - decl_spaces, '-' }
+                        << " initial deletion here\n" << ansi::reset;
+                    out << padding << " | \n";
+
+                    out << on_line + 1 << err_pad << " | "
+                        << ansi::red << err_text
+                        << ansi::reset << '\n';
+                    out << padding << " | "
+                        << report_buffer::repeat { count_spaces, ' ' }
+                        << ansi::red << report_buffer::repeat { err_text.size() - count_spaces, '^' }
+                        << " second delete here\n" << ansi::reset;
+                    out << padding << " | \n";
                 }
                     break;
 
                 case error_t::previously_tracked:
                 {
-                    decl_path = error.key.allocation_point.filename;
-                    decl_line = error.key.allocation_point.line - 1;
-                    decl_pad = std::string( padding.size() - pad_with(decl_line + 1).size(), ' ' );
-                    load_file(decl_path);
-                    decl_spaces = get_spaces(file_lines[decl_path][decl_line]);
-
-                    std::cout << ansi::red << "error"
-                              << ansi::reset << ": overwrote tracking of previously tracked variable\n";
-                    std::cout << padding << " ---> " << print_path << ':' << on_line + 1 << ':' << '\n';
-                    std::cout << padding << " | \n";
-                    std::cout << decl_line + 1 << decl_pad << " | "
-                              << ansi::blue << file_lines[decl_path][decl_line]
-                              << ansi::reset << '\n';
-                    std::cout << padding << " | "
-                              << std::string(decl_spaces, ' ')
-                              << ansi::blue << std::string(file_lines[decl_path][decl_line].size() - decl_spaces, '-')
-                              << " initial tracking here\n" << ansi::reset;
-                    std::cout << padding << " | \n";
-
-                    std::cout << on_line + 1 << " | "
-                              << ansi::red << file_lines[err_path][on_line]
-                              << ansi::reset << '\n';
-                    std::cout << padding << " | "
-                              << std::string(count_spaces, ' ')
-                              << ansi::red << std::string(file_lines[err_path][on_line].size() - count_spaces, '^')
-                              << " overwrote tracking here\n" << ansi::reset;
-                    std::cout << padding << " | \n";
+                    decl_text = source_line(error.key.allocation_point);
+                    decl_line = error.key.allocation_point.line() - 1;
+                    decl_pad = { padding.count - report_buffer::digits(decl_line + 1) };
+                    decl_spaces = get_spaces(decl_text);
+
+                    out << ansi::red << "error"
+                        << ansi::reset << ": overwrote tracking of previously tracked variable" << occurrences { record } << '\n';
+                    out << padding << " ---> " << print_path << ':' << on_line + 1 << ':' << '\n';
+                    out << padding << " | \n";
+                    out << decl_line + 1 << decl_pad << " | "
+                        << ansi::blue << decl_text
+                        << ansi::reset << '\n';
+                    out << padding << " | "
+                        << report_buffer::repeat { decl_spaces, ' ' }
+                        << ansi::blue << report_buffer::repeat { decl_text.size() - decl_spaces, '-' }
+                        << " initial tracking here\n" << ansi::reset;
+                    out << padding << " | \n";
+
+                    out << on_line + 1 << err_pad << " | "
+                        << ansi::red << err_text
+                        << ansi::reset << '\n';
+                    out << padding << " | "
+                        << report_buffer::repeat { count_spaces, ' ' }
+                        << ansi::red << report_buffer::repeat { err_text.size() - count_spaces, '^' }
+                        << " overwrote tracking here\n" << ansi::reset;
+                    out << padding << " | \n";
                 }
                     break;
 
                 case error_t::untracked:
                 {
-                    std::cout << ansi::red << "error"
-                              << ansi::reset << ": attempted deletion of untracked pointer\n";
-                    std::cout << padding << " ---> " << print_path << ':' << on_line + 1 << ':' << '\n';
-                    std::cout << padding << " | \n";
-                    std::cout << on_line + 1 << " | "
-                              << ansi::red << file_lines[err_path][on_line]
-                              << ansi::reset << '\n';
-                    std::cout << padding << " | "
-                              << std::string(count_spaces, ' ')
-                              << ansi::red << std::string(file_lines[err_path][on_line].size() - count_spaces, '^')
-                              << " here\n" << ansi::reset;
-                    std::cout << padding << " | \n";
+                    out << ansi::red << "error"
+                        << ansi::reset << ": attempted deletion of untracked pointer" << occurrences { record } << '\n';
+                    out << padding << " ---> " << print_path << ':' << on_line + 1 << ':' << '\n';
+                    out << padding << " | \n";
+                    out << on_line + 1 << err_pad << " | "
+                        << ansi::red << err_text
+                        << ansi::reset << '\n';
+                    out << padding << " | "
+                        << report_buffer::repeat { count_spaces, ' ' }
+                        << ansi::red << report_buffer::repeat { err_text.size() - count_spaces, '^' }
+                        << " here\n" << ansi::reset;
+                    out << padding << " | \n";
                 }
                     break;
 
                 case error_t::type_pun:
                 {
-                    decl_path = error.key.allocation_point.filename;
-                    decl_line = error.key.allocation_point.line - 1;
-                    decl_pad = std::string( padding.size() - pad_with(decl_line + 1).size(), ' ' );
-                    load_file(decl_path);
-                    decl_spaces = get_spaces(file_lines[decl_path][decl_line]);
-
-                    std::cout << ansi::red << "error"
-                              << ansi::reset << ": deleted pointer did not match allocated type\n";
-                    std::cout << padding << " ---> " << print_path << ':' << on_line + 1 << ':' << '\n';
-                    std::cout << padding << " | \n";
-                    std::cout << decl_line + 1 << decl_pad << " | "
-                              << ansi::blue << file_lines[decl_path][decl_line]
-                              << ansi::reset << '\n';
-                    std::cout << padding << " | "
-                              << std::string(decl_spaces, ' ')
-                              << ansi::blue << std::string(file_lines[decl_path][decl_line].size() - decl_spaces, '-')
-                              << " allocated as type \"" << types[error.key.type_hash] << '"' << ansi::reset << '\n';
-                    std::cout << padding << " | \n";
-
-                    std::cout << on_line + 1 << " | "
-                              << ansi::red << file_lines[err_path][on_line]
-                              << ansi::reset << '\n';
-                    std::cout << padding << " | "
-                              << std::string(count_spaces, ' ')
-                              << ansi::red << std::string(file_lines[err_path][on_line].size() - count_spaces, '^')
-                              << " deleted as type \"" << types[error.type_hash] << '"' << ansi::reset << '\n';
-                    std::cout << padding << " | \n";
+                    decl_text = source_line(error.key.allocation_point);
+                    decl_line = error.key.allocation_point.line() - 1;
+                    decl_pad = { padding.count - report_buffer::digits(decl_line + 1) };
+                    decl_spaces = get_spaces(decl_text);
+
+                    out << ansi::red << "error"
+                        << ansi::reset << ": deleted pointer did not match allocated type" << occurrences { record } << '\n';
+                    out << padding << " ---> " << print_path << ':' << on_line + 1 << ':' << '\n';
+                    out << padding << " | \n";
+                    out << decl_line + 1 << decl_pad << " | "
+                        << ansi::blue << decl_text
+                        << ansi::reset << '\n';
+                    out << padding << " | "
+                        << report_buffer::repeat { decl_spaces, ' ' }
+                        << ansi::blue << report_buffer::repeat { decl_text.size() - decl_spaces, '-' }
+                        << " allocated as type \"" << error.key.type->name << '"' << ansi::reset << '\n';
+                    out << padding << " | \n";
+
+                    out << on_line + 1 << err_pad << " | "
+                        << ansi::red << err_text
+                        << ansi::reset << '\n';
+                    out << padding << " | "
+                        << report_buffer::repeat { count_spaces, ' ' }
+                        << ansi::red << report_buffer::repeat { err_text.size() - count_spaces, '^' }
+                        << " deleted as type \"" << error.type->name << '"' << ansi::reset << '\n';
+                    out << padding << " | \n";
+                }
+                    break;
+
+                case error_t::mismatched_delete:
+                {
+                    const bool is_array = error.key.kind == allocation_kind::array;
+                    out << ansi::red << "error"
+                        << ansi::reset << ": mismatched " << (is_array ? "delete" : "delete[]") << " of pointer" << occurrences { record } << '\n';
+                    out << padding << " ---> " << print_path << ':' << on_line + 1 << ':' << '\n';
+                    out << padding << " | \n";
+
+                    if(error.key.allocation_point.site) {
+                        decl_text = source_line(error.key.allocation_point);
+                        decl_line = error.key.allocation_point.line() - 1;
+                        decl_pad = { padding.count - report_buffer::digits(decl_line + 1) };
+                        decl_spaces = get_spaces(decl_text);
+
+                        out << decl_line + 1 << decl_pad << " | "
+                            << ansi::blue << decl_text
+                            << ansi::reset << '\n';
+                        out << padding << " | "
+                            << report_buffer::repeat { decl_spaces, ' ' }
+                            << ansi::blue << report_buffer::repeat { decl_text.size() - decl_spaces, '-' }
+                            << " allocated with " << (is_array ? "new[]" : "new") << ansi::reset << '\n';
+                    }
+                    else {
+                        out << padding << " | "
+                            << ansi::blue << "allocated with " << (is_array ? "new[]" : "new")
+                            << " called from " << error.key.caller << ansi::reset << '\n';
+                    }
+                    out << padding << " | \n";
+
+                    out << on_line + 1 << err_pad << " | "
+                        << ansi::red << err_text
+                        << ansi::reset << '\n';
+                    out << padding << " | "
+                        << report_buffer::repeat { count_spaces, ' ' }
+                        << ansi::red << report_buffer::repeat { err_text.size() - count_spaces, '^' }
+                        << " deleted with " << (is_array ? "delete" : "delete[]") << ansi::reset << '\n';
+                    out << padding << " | \n";
                 }
                     break;
+
+                case error_t::written_after_free:
+                {
+                    out << ansi::red << "error"
+                        << ansi::reset << ": deleted memory was written to" << occurrences { record } << '\n';
+                    out << padding << " ---> " << print_path << ':' << on_line + 1 << ':' << '\n';
+                    out << padding << " | \n";
+
+                    if(error.key.allocation_point.site) {
+                        decl_text = source_line(error.key.allocation_point);
+                        decl_line = error.key.allocation_point.line() - 1;
+                        decl_pad = { padding.count - report_buffer::digits(decl_line + 1) };
+                        decl_spaces = get_spaces(decl_text);
+
+                        out << decl_line + 1 << decl_pad << " | "
+                            << ansi::blue << decl_text
+                            << ansi::reset << '\n';
+                        out << padding << " | "
+                            << report_buffer::repeat { decl_spaces, ' ' }
+                            << ansi::blue << report_buffer::repeat { decl_text.size() - decl_spaces, '-' }
+                            << " allocated here" << ansi::reset << '\n';
+                    }
+                    else {
+                        out << padding << " | "
+                            << ansi::blue << "allocated with " << (error.key.kind == allocation_kind::array ? "new[]" : "new")
+                            << " called from " << error.key.caller << ansi::reset << '\n';
+                    }
+                    out << padding << " | \n";
+
+                    out << on_line + 1 << err_pad << " | "
+                        << ansi::red << err_text
+                        << ansi::reset << '\n';
+                    out << padding << " | "
+                        << report_buffer::repeat { count_spaces, ' ' }
+                        << ansi::red << report_buffer::repeat { err_text.size() - count_spaces, '^' }
+                        << " deleted here, written to before it was released" << ansi::reset << '\n';
+                    out << padding << " | \n";
+                }
+                    break;
+
+                case error_t::not_destroyed:
+                {
+                    decl_text = source_line(error.key.allocation_point);
+                    decl_line = error.key.allocation_point.line() - 1;
+                    decl_pad = { padding.count - report_buffer::digits(decl_line + 1) };
+                    decl_spaces = get_spaces(decl_text);
+
+                    out << ansi::red << "error"
+                        << ansi::reset << ": memory released without running destructor" << occurrences { record } << '\n';
+                    out << padding << " ---> " << print_path << ':' << on_line + 1 << ':' << '\n';
+                    out << padding << " | \n";
+                    out << decl_line + 1 << decl_pad << " | "
+                        << ansi::blue << decl_text
+                        << ansi::reset << '\n';
+                    out << padding << " | "
+                        << report_buffer::repeat { decl_spaces, ' ' }
+                        << ansi::blue << report_buffer::repeat { decl_text.size() - decl_spaces, '-' }
+                        << " \"" << error.key.type->name << "\" created here" << ansi::reset << '\n';
+                    out << padding << " | \n";
+
+                    out << on_line + 1 << err_pad << " | "
+                        << ansi::red << err_text
+                        << ansi::reset << '\n';
+                    out << padding << " | "
+                        << report_buffer::repeat { count_spaces, ' ' }
+                        << ansi::red << report_buffer::repeat { err_text.size() - count_spaces, '^' }
+                        << " released here" << ansi::reset << '\n';
+                    out << padding << " | \n";
+                }
+                    break;
+            }
+
+            list_stack(out, stacks, error.loc.stack, padding);
+            if(related.loc) list_stack(out, stacks, related.loc->stack, padding, related.what);
+            out << '\n';
+        }
+    }
+
+    /* Rule names shared by both structured formats, indexed by error type with leaks last. */
+    static constexpr std::string_view rule_names[] {
+        "overwritten-tracking",
+        "double-delete",
+        "type-mismatch",
+        "untracked-delete",
+        "mismatched-delete",
+        "write-after-free",
+        "destructor-skipped",
+        "leak",
+    };
+
+    static constexpr std::string_view rule_descriptions[] {
+        "A tracked pointer was tracked again before being deleted",
+        "A pointer was deleted more than once",
+        "A pointer was deleted as a different type than it was allocated as",
+        "A pointer that was never tracked was deleted",
+        "A pointer was deleted with the wrong form of delete",
+        "Memory was written to after it was deleted",
+        "An object was released in bulk without running its destructor",
+        "A tracked pointer was never deleted",
+    };
+
+    static constexpr std::size_t leak_rule = std::size(rule_names) - 1;
+
+    struct quoted {
+        std::string_view text;
+    };
+
+    static report_buffer& operator<<(report_buffer& out, const quoted& str) {
+        return out << '"' << report_buffer::json_escaped { str.text } << '"';
+    }
+
+    static std::string_view new_form(const allocation_kind kind) {
+        return kind == allocation_kind::array ? "new[]" : "new";
+    }
+
+    /* The one line summary of an error, without quotes or escaping. */
+    static void error_message(report_buffer& out, const allocation_registry::error_key& error) {
+        using error_t = allocation_registry::error_key::error_type;
+        using json_escaped = report_buffer::json_escaped;
+        switch(error.err) {
+            case error_t::previously_tracked:
+                out << "overwrote tracking of previously tracked variable";
+                break;
+            case error_t::previously_deleted:
+                out << "double deletion found";
+                break;
+            case error_t::type_pun:
+                out << "deleted pointer did not match allocated type, allocated as \\\""
+                    << json_escaped { error.key.type->name } << "\\\" and deleted as \\\""
+                    << json_escaped { error.type->name } << "\\\"";
+                break;
+            case error_t::untracked:
+                out << "attempted deletion of untracked pointer";
+                break;
+            case error_t::mismatched_delete:
+                out << "mismatched " << (error.key.kind == allocation_kind::array ? "delete" : "delete[]")
+                    << " of pointer allocated with " << new_form(error.key.kind);
+                if(not error.key.allocation_point.site) out << " called from " << error.key.caller;
+                break;
+            case error_t::written_after_free:
+                out << "deleted memory was written to before it was released";
+                if(not error.key.allocation_point.site) {
+                    out << ", allocated with " << new_form(error.key.kind) << " called from " << error.key.caller;
+                }
+                break;
+            case error_t::not_destroyed:
+                out << "memory released without running the destructor of \\\""
+                    << report_buffer::json_escaped { error.key.type->name } << "\\\"";
+                break;
+        }
+    }
+
+    static void leak_message(report_buffer& out, const leak_record& leak) {
+        const auto& key = leak.first;
+        if constexpr(sample_interval > 0) out << '~' << std::size_t(leak.estimated_count + 0.5) << " unfreed pointers";
+        else {
+            out << leak.pointers << " unfreed " << (key.kind == allocation_kind::array ? "array" : "pointer")
+                << (leak.pointers == 1 ? "" : "s");
+        }
+        if(key.interposed) out << " allocated with " << new_form(key.kind) << " called from " << key.caller;
+        else out << " of type \\\"" << report_buffer::json_escaped { key.type->name } << "\\\"";
+        if constexpr(sample_interval > 0) {
+            out << " (~" << std::size_t(leak.estimated_bytes + 0.5) << " bytes, estimated from "
+                << leak.pointers << " sample" << (leak.pointers == 1 ? "" : "s") << ')';
+        }
+        else out << " (" << leak.bytes << " bytes)";
+    }
+
+    static void json_location(report_buffer& out, const allocation_registry::data_location& loc) {
+        out << "{\"file\":" << quoted { loc.site->file } << ",\"line\":" << loc.line() << '}';
+    }
+
+    static void json_stack(report_buffer& out, stack_store& stacks, const stack_id id) {
+        const auto names = stack_names(stacks, id);
+        if(names.empty()) return;
+        out << ",\"stack\":[";
+        for(std::size_t idx = 0; idx < names.size(); ++idx) {
+            if(idx > 0) out << ',';
+            out << quoted { names[idx] };
+        }
+        out << ']';
+    }
+
+    /* One self-contained object per line, leaks first. */
+    static void list_json_lines(report_buffer& out, stack_store& stacks, const std::vector<leak_record>& leaks,
+                                const std::vector<allocation_registry::error_record>& errors) {
+        for(auto& leak : leaks) {
+            const auto& key = leak.first;
+            out << "{\"kind\":\"leak\",\"rule\":\"" << rule_names[leak_rule] << "\",\"message\":\"";
+            leak_message(out, leak);
+            out << "\",\"allocated_with\":\"" << new_form(key.kind) << '"';
+            if(key.interposed) out << ",\"caller\":\"" << key.caller << '"';
+            else {
+                out << ",\"location\":";
+                json_location(out, key.allocation_point);
+                out << ",\"type\":" << quoted { key.type->name };
+            }
+            json_stack(out, stacks, key.allocation_point.stack);
+            out << ",\"pointers\":" << leak.pointers << ",\"count\":" << leak.count << ",\"bytes\":" << leak.bytes;
+            if constexpr(sample_interval > 0) {
+                out << ",\"estimated_count\":" << std::size_t(leak.estimated_count + 0.5)
+                    << ",\"estimated_bytes\":" << std::size_t(leak.estimated_bytes + 0.5);
+            }
+            out << "}\n";
+        }
+
+        for(auto& record : errors) {
+            const auto& error = record.first;
+            out << "{\"kind\":\"error\",\"rule\":\"" << rule_names[std::size_t(error.err)] << "\",\"message\":\"";
+            error_message(out, error);
+            out << '"';
+            if(error.loc.site) {
+                out << ",\"location\":";
+                json_location(out, error.loc);
+            }
+            json_stack(out, stacks, error.loc.stack);
+            if(const auto related = related_to(error); related.loc and related.loc->site) {
+                out << ",\"related\":{\"message\":\"" << related.what << "\",\"location\":";
+                json_location(out, *related.loc);
+                json_stack(out, stacks, related.loc->stack);
+                out << '}';
+            }
+            if(error.key.interposed) out << ",\"caller\":\"" << error.key.caller << '"';
+            if(error.key.type and not error.key.interposed) out << ",\"type\":" << quoted { error.key.type->name };
+            if(error.type and error.type != error.key.type) out << ",\"deleted_type\":" << quoted { error.type->name };
+            out << ",\"count\":" << record.count << ",\"bytes\":" << record.bytes << "}\n";
+        }
+    }
+
+    /* Absolute paths become file URIs, relative ones are left relative to the source root. */
+    static void sarif_uri(report_buffer& out, std::string_view path) {
+        out << '"';
+        if(path.size() > 1 and path[1] == ':') out << "file:///";
+        else if(not path.empty() and path[0] == '/') out << "file://";
+        for(const char c : path) {
+            switch(c) {
+                case '\\': out << '/'; break;
+                case ' ':  out << "%20"; break;
+                case '%':  out << "%25"; break;
+                default:   out << report_buffer::json_escaped { std::string_view { &c, 1 } };
+            }
+        }
+        out << '"';
+    }
+
+    static void sarif_location(report_buffer& out, const allocation_registry::data_location& loc) {
+        out << "{\"physicalLocation\":{\"artifactLocation\":{\"uri\":";
+        sarif_uri(out, loc.site->file);
+        out << "},\"region\":{\"startLine\":" << loc.line() << "}}";
+    }
+
+    static void sarif_result(report_buffer& out, bool& first, const std::size_t rule) {
+        if(not first) out << ',';
+        first = false;
+        out << "{\"ruleId\":\"" << rule_names[rule] << "\",\"ruleIndex\":" << rule
+            << ",\"level\":\"error\",\"message\":{\"text\":\"";
+    }
+
+    /* Call stacks of a result, each frame's location only has a message naming the function. */
+    static void sarif_stacks(report_buffer& out, stack_store& stacks, const stack_id id,
+                             const stack_id related = 0, const std::string_view related_what = {}) {
+        bool first = true;
+        for(const auto& [stack, what] : { std::pair { id, std::string_view { "called from" } }, std::pair { related, related_what } }) {
+            const auto names = stack_names(stacks, stack);
+            if(names.empty()) continue;
+            out << (first ? ",\"stacks\":[" : ",") << "{\"message\":{\"text\":\"" << what << "\"},\"frames\":[";
+            for(std::size_t idx = 0; idx < names.size(); ++idx) {
+                if(idx > 0) out << ',';
+                out << "{\"location\":{\"message\":{\"text\":" << quoted { names[idx] } << "}}}";
             }
+            out << "]}";
+            first = false;
+        }
+        if(not first) out << ']';
+    }
+
+    /* Results of one report, after those of the earlier reports of the run. */
+    static void list_sarif_results(report_buffer& out, stack_store& stacks, const std::vector<leak_record>& leaks,
+                                   const std::vector<allocation_registry::error_record>& errors) {
+        bool first = out.empty();
+        for(auto& record : errors) {
+            const auto& error = record.first;
+            sarif_result(out, first, std::size_t(error.err));
+            error_message(out, error);
+            out << "\"}";
+            if(error.loc.site) {
+                out << ",\"locations\":[";
+                sarif_location(out, error.loc);
+                out << "}]";
+            }
+            const auto related = related_to(error);
+            if(related.loc and related.loc->site) {
+                out << ",\"relatedLocations\":[";
+                sarif_location(out, *related.loc);
+                out << ",\"id\":1,\"message\":{\"text\":\"" << related.what << "\"}}]";
+            }
+            sarif_stacks(out, stacks, error.loc.stack, related.loc ? related.loc->stack : 0, related.what);
+            out << ",\"occurrenceCount\":" << record.count
+                << ",\"properties\":{\"bytes\":" << record.bytes << "}}";
+        }
+        for(auto& leak : leaks) {
+            sarif_result(out, first, leak_rule);
+            leak_message(out, leak);
+            out << "\"}";
+            if(not leak.first.interposed) {
+                out << ",\"locations\":[";
+                sarif_location(out, leak.first.allocation_point);
+                out << "}]";
+            }
+            sarif_stacks(out, stacks, leak.first.allocation_point.stack);
+            out << ",\"occurrenceCount\":" << leak.pointers
+                << ",\"properties\":{\"count\":" << leak.count << ",\"bytes\":" << leak.bytes << "}}";
+        }
+    }
+
+    /* A single SARIF 2.1.0 log with one run, holding the results of every report. */
+    static void list_sarif(report_buffer& out, const std::string_view results) {
+        out << "{\"version\":\"2.1.0\","
+               "\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\","
+               "\"runs\":[{\"tool\":{\"driver\":{\"name\":\"suiveur\","
+               "\"informationUri\":\"https://github.com/8ightfold/suiveur\",\"rules\":[";
+        for(std::size_t rule = 0; rule < std::size(rule_names); ++rule) {
+            if(rule > 0) out << ',';
+            out << "{\"id\":\"" << rule_names[rule] << "\",\"shortDescription\":{\"text\":\""
+                << rule_descriptions[rule] << "\"}}";
+        }
+        out << "]}},\"results\":[" << results << "]}]}\n";
+    }
 
-            std::cout << std::endl;
+    std::vector<leak_record> allocation_registry::collect_leaks(const generation since) {
+        leak_table leaks;
+        for(auto& s : get().shards) {
+            std::lock_guard guard { s.lock };
+            for(auto& [addr, key] : s.keys) {
+                if(key.made_in < since) continue;
+                const leak_id id { key.allocation_point.site, key.caller, key.type, key.kind, key.allocation_point.stack };
+                auto [entry, inserted] = leaks.try_emplace(id);
+                auto& leak = entry->value;
+                if(inserted) leak.first = key;
+                ++leak.pointers;
+                leak.count += key.count;
+                leak.bytes += key.size;
+                leak.estimated_count += sample_weight(key.size);
+                leak.estimated_bytes += sample_weight(key.size) * double(key.size);
+            }
         }
+
+        std::vector<leak_record> sorted;
+        sorted.reserve(leaks.size());
+        for(auto& [id, leak] : leaks) sorted.push_back(leak);
+        std::sort(sorted.begin(), sorted.end(), [](const leak_record& lhs, const leak_record& rhs) {
+            return lhs.bytes != rhs.bytes ? lhs.bytes > rhs.bytes : lhs.pointers > rhs.pointers;
+        });
+        return sorted;
+    }
+
+    void allocation_registry::write_report(const bool leaks, const bool errors, const generation since) {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        flush_all();
+        const auto leak_list { leaks ? collect_leaks(since) : std::vector<leak_record> {} };
+        const auto error_list { errors ? collect_errors() : std::vector<error_record> {} };
+
+        auto& reg = get();
+        std::lock_guard report_guard { reg.report_lock };
+        auto& out = reg.report;
+        switch(reg.format) {
+            case report_format::text:
+                if(not leak_list.empty()) {
+                    if constexpr(sample_interval > 0) list_sampled(out, reg.stacks, leak_list);
+                    else list_unsampled(out, reg.stacks, leak_list);
+                }
+                if(not error_list.empty()) list_errors(out, reg.sources, reg.stacks, error_list);
+                break;
+
+            case report_format::json_lines:
+                list_json_lines(out, reg.stacks, leak_list, error_list);
+                break;
+
+            /* Kept until the run is closed, a file holds one log however many reports went into it. */
+            case report_format::sarif:
+                list_sarif_results(reg.sarif_results, reg.stacks, leak_list, error_list);
+                break;
+        }
+        if(not out.empty()) reg.sink.write(out.view());
+        out.clear();
+    }
+
+    /* Written even when clean, so tools can tell a passing run from a missing report. */
+    void allocation_registry::end_sarif_run() {
+        list_sarif(report, sarif_results.view());
+        sink.write(report.view());
+        report.clear();
+        sarif_results.clear();
+    }
+
+    /* Ends what was written to the current sink, and closes the file it was opened on. */
+    void allocation_registry::close_report() {
+        std::lock_guard guard { report_lock };
+        if(format == report_format::sarif) end_sarif_run();
+        close_report_file();
+    }
+
+    void allocation_registry::close_report_file() {
+        if(report_file) {
+            std::fclose(report_file);
+            report_file = nullptr;
+            sink = report_sink::to_stream(std::cout);
+        }
+    }
+
+    void allocation_registry::print_errors() {
+        write_report(false, true);
     }
 
     void allocation_registry::list_nonfreed() {
-        auto& keys = get().registry_keys;
-        if(keys.empty()) return;
-        std::size_t free_count = keys.size();
-
-        std::cout << ansi::red << "error" << ansi::reset << ": " << free_count
-                  << " unfreed pointer" << ((free_count == 1) ? "" : "s") << " at:\n";
-        std::cout << ansi::red;
-        for(auto& [key, value] : keys) {
-            auto& file = value.allocation_point.filename;
-            const auto line = value.allocation_point.line;
-            const std::string print_path = (file.parent_path().filename() / file.filename()).string();
-            std::cout << "---> " << print_path << ':' << line << '\n';
-        }
-        std::cout << ansi::reset << std::endl;
+        write_report(true, false);
+    }
+
+    void allocation_registry::print_report() {
+        write_report(true, true);
+    }
+
+    /* Allocations made from here on belong to the returned generation or a later one. */
+    allocation_registry::generation allocation_registry::snapshot() {
+        return current_generation.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    /* Still live allocations made since the snapshot, grouped by site like leaks. */
+    std::vector<leak_record> allocation_registry::diff(const generation since) {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        flush_all();
+        return collect_leaks(since);
+    }
+
+    void allocation_registry::print_diff(const generation since) {
+        write_report(true, false, since);
     }
 }
@@ -1,35 +1,73 @@
 #ifndef MEMORY_TRACKER_ALLOCATION_REGISTRY_HPP
 #define MEMORY_TRACKER_ALLOCATION_REGISTRY_HPP
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <filesystem>
-#include <map>
+#include <memory>
+#include <optional>
 #include <vector>
 
+#include "allocation_stats.hpp"
+#include "call_site.hpp"
+#include "call_stack.hpp"
 #include "cttypeid.hpp"
-#include "type_names.hpp"
+#include "deleted_history.hpp"
+#include "flat_table.hpp"
+#include "quarantine.hpp"
+#include "reentrancy_guard.hpp"
+#include "registry_mutex.hpp"
+#include "report_writer.hpp"
+#include "sampling.hpp"
+#include "source_cache.hpp"
+#include "tracking_switch.hpp"
 
 namespace suiveur {
     namespace fs = std::filesystem;
 
+    enum class allocation_kind : std::uint8_t {
+        scalar,
+        array,
+    };
+
     struct allocation_registry {
+        /* Marks a point in the allocation history, keys remember the one they were made in. */
+        using generation = std::uint64_t;
+
         struct data_location {
-            std::size_t line = static_cast<std::size_t>(-1);
-            fs::path filename;
+            const call_site* site = nullptr;
+            stack_id stack = 0;
 
             data_location() = default;
-            data_location(const std::size_t line, const fs::path file) : line(line), filename(file) {}
+            explicit data_location(const call_site* site) : site(site) {}
+            data_location(const call_site* site, const stack_id stack) : site(site), stack(stack) {}
+
+            [[nodiscard]] std::size_t line() const { return site ? site->line : static_cast<std::size_t>(-1); }
+            [[nodiscard]] fs::path filename() const { return site ? fs::path { site->file } : fs::path {}; }
         };
 
         struct allocation_key {
             void* data = nullptr;
-            std::size_t type_hash;
+            type_id type = nullptr;
             data_location allocation_point;
             data_location deletion_point;
+            std::size_t size = 0;
+            std::size_t count = 1;
+            const void* caller = nullptr;
+            generation made_in = 0;
+            std::uint64_t born = 0;  /* lifetime_clock ticks */
+            allocation_kind kind = allocation_kind::scalar;
+            bool interposed = false;
 
-            explicit allocation_key(const std::size_t type) : type_hash(type) {}
+            allocation_key() = default;
+            explicit allocation_key(const type_id type) : type(type) {}
 
-            allocation_key(void* addr, const std::size_t type, const std::size_t line, const fs::path file)
-                    : data(addr), type_hash(type), allocation_point(line, file) {}
+            allocation_key(void* addr, const type_id type, const call_site* site, const std::size_t size = 0,
+                           const allocation_kind kind = allocation_kind::scalar, const std::size_t count = 1)
+                    : data(addr), type(type), allocation_point(site), size(size), count(count), kind(kind) {}
         };
 
         struct error_key {
@@ -38,46 +76,297 @@ namespace suiveur {
                 previously_deleted,
                 type_pun,
                 untracked,
+                mismatched_delete,
+                written_after_free,
+                not_destroyed,
             };
 
             allocation_key key;
             data_location loc;
-            std::size_t type_hash;
-            error_type err;
+            type_id type = nullptr;
+            error_type err = error_type::untracked;
+
+            error_key() = default;
+
+            error_key(const allocation_key& key, data_location loc, error_type err)
+                    : key(key), loc(std::move(loc)), type(key.type), err(err) {}
+
+            error_key(const allocation_key& key, data_location loc, error_type err, type_id type)
+                    : key(key), loc(std::move(loc)), type(type), err(err) {}
+        };
+
+        /* Every occurrence of one error at the same sites, first is kept as it was recorded. */
+        struct error_record {
+            error_key first;
+            std::size_t count = 0;
+            std::size_t bytes = 0;
+            std::uint64_t first_seen = 0;
+            std::uint64_t last_seen = 0;
+        };
 
-            error_key(allocation_key& key, data_location loc, error_type err)
-                    : key(key), loc(std::move(loc)), type_hash(key.type_hash), err(err) {}
+        /* A live pointer and how long ago it was allocated. */
+        struct live_allocation {
+            allocation_key key;
+            std::uint64_t age_ns = 0;
+        };
 
-            error_key(allocation_key& key, data_location loc, error_type err, std::size_t type)
-                    : key(key), loc(std::move(loc)), type_hash(type), err(err) {}
+        /* Unfreed pointers from one site, estimates scale samples up to the allocations they stand for. */
+        struct leak_record {
+            allocation_key first;
+            std::size_t pointers = 0;
+            std::size_t count = 0;
+            std::size_t bytes = 0;
+            double estimated_count = 0;
+            double estimated_bytes = 0;
         };
 
-        using deleted_iter = std::vector<allocation_key>::iterator;
+        using key_table = flat_table<void*, allocation_key>;
+
+        static void record_allocation(void*, type_id, const call_site*, std::size_t size = 0,
+                                      allocation_kind kind = allocation_kind::scalar, std::size_t count = 1);
+        static bool record_deletion(void*, type_id, const call_site*, allocation_kind kind = allocation_kind::scalar);
+        static bool safe_deletion(void*, type_id, const call_site*, allocation_kind kind = allocation_kind::scalar,
+                                  allocation_key* erased = nullptr);
 
-        static void record_allocation(void*, std::size_t, std::size_t, fs::path);
-        static bool record_deletion(void*, std::size_t, std::size_t, fs::path);
-        static bool safe_deletion(void*, std::size_t, std::size_t, fs::path);
+        static void record_global_allocation(void*, std::size_t size, allocation_kind kind, const void* caller) noexcept;
+        static void record_global_deletion(void*, allocation_kind kind) noexcept;
 
-        static deleted_iter find_deleted(void*, std::size_t);
+        static void record_undestroyed(void*, type_id, const call_site* created, std::size_t size, const call_site* released);
+        /* Puts back an error read from a crash dump, seen count times for bytes in all. */
+        static void restore_error(const error_key&, std::size_t count, std::size_t bytes);
+
+        static std::optional<allocation_key> find_deleted(void*, type_id);
+        static void configure_deleted_history(std::size_t capacity, eviction_policy policy = eviction_policy::fifo);
+        static void configure_quarantine(std::size_t capacity, bool protect = false);
+        static bool quarantine_enabled() { return quarantine_capacity.load(std::memory_order_relaxed) > 0; }
+        static void quarantine(const allocation_key& key, std::size_t size, release_function release);
+        static void drain_quarantine();
+        static allocation_stats stats();
+        static std::vector<live_allocation> oldest(std::size_t count);
+        static generation snapshot();
+        static std::vector<leak_record> diff(generation since);
+        static void print_diff(generation since);
+        static void set_report_sink(report_sink sink);
+        static void set_report_format(report_format format);
         static void print_errors();
         static void list_nonfreed();
+        static void print_report();
 
         static allocation_registry& get();
         static void erase();
         static void pass();
 
         ~allocation_registry() {
+            shut_down = true;
 #ifdef ENABLE_MEMORY_REGISTRY
-            list_nonfreed();
-            print_errors();
+            drain_quarantine();
+            print_report();
 #endif
+            close_report();
         }
 
     private:
+        /* All that is kept of a pointer while the event log is open, enough to decide whether to free it. */
+        struct logged_pointer {
+            type_id type = nullptr;
+            allocation_kind kind = allocation_kind::scalar;
+            bool interposed = false;
+        };
+
+        /* Deleted memory held back from the allocator, checked for writes when it is let go. */
+        struct quarantined {
+            allocation_key key;
+            std::size_t size = 0;
+            release_function release = nullptr;
+            bool protected_pages = false;
+        };
+
+        struct alignas(64) shard {
+            registry_mutex lock;
+            key_table keys;
+            deleted_history<allocation_key> deleted { shard_capacity(deleted_capacity), deleted_policy };
+            flat_table<void*, logged_pointer> logged;
+        };
+
+        /* Signed, a pointer may be deleted on another thread than the one that allocated it. */
+        struct usage {
+            std::int64_t live_count = 0;
+            std::int64_t live_bytes = 0;
+            std::uint64_t total_count = 0;
+            std::uint64_t total_bytes = 0;
+            lifetime_histogram lifetimes;
+            bool interposed = false;
+        };
+
+        using usage_table = flat_table<const void*, usage>;
+
+        struct error_id {
+            const call_site* site = nullptr;
+            const call_site* allocated = nullptr;
+            const call_site* deleted = nullptr;
+            const void* caller = nullptr;
+            type_id type = nullptr;
+            type_id other_type = nullptr;
+            error_key::error_type err {};
+            stack_id stack = 0;
+
+            friend bool operator==(const error_id& lhs, const error_id& rhs) {
+                return lhs.site == rhs.site && lhs.allocated == rhs.allocated && lhs.deleted == rhs.deleted
+                       && lhs.caller == rhs.caller && lhs.type == rhs.type && lhs.other_type == rhs.other_type
+                       && lhs.err == rhs.err && lhs.stack == rhs.stack;
+            }
+            friend bool operator!=(const error_id& lhs, const error_id& rhs) { return not (lhs == rhs); }
+        };
+
+        struct error_id_traits {
+            static constexpr error_id empty() { return {}; }
+
+            static std::uint64_t hash(const error_id& id) {
+                std::uint64_t h = static_cast<std::uint64_t>(id.err) ^ (std::uint64_t { id.stack } << 8);
+                for(const void* part : { static_cast<const void*>(id.site), static_cast<const void*>(id.allocated),
+                                         static_cast<const void*>(id.deleted), id.caller,
+                                         static_cast<const void*>(id.type), static_cast<const void*>(id.other_type) }) {
+                    h = (h ^ address_traits<const void*>::hash(part)) * 0xC2B2AE3D27D4EB4Full;
+                }
+                return h;
+            }
+        };
+
+        using error_table = flat_table<error_id, error_record, error_id_traits>;
+
+        /* Leaks are grouped by where they were allocated and as what. */
+        struct leak_id {
+            const call_site* site = nullptr;
+            const void* caller = nullptr;
+            type_id type = nullptr;
+            allocation_kind kind = allocation_kind::scalar;
+            stack_id stack = 0;
+
+            friend bool operator==(const leak_id& lhs, const leak_id& rhs) {
+                return lhs.site == rhs.site && lhs.caller == rhs.caller && lhs.type == rhs.type && lhs.kind == rhs.kind
+                       && lhs.stack == rhs.stack;
+            }
+            friend bool operator!=(const leak_id& lhs, const leak_id& rhs) { return not (lhs == rhs); }
+        };
+
+        struct leak_id_traits {
+            static constexpr leak_id empty() { return {}; }
+
+            static std::uint64_t hash(const leak_id& id) {
+                std::uint64_t h = static_cast<std::uint64_t>(id.kind) ^ (std::uint64_t { id.stack } << 8);
+                for(const void* part : { static_cast<const void*>(id.site), id.caller, static_cast<const void*>(id.type) }) {
+                    h = (h ^ address_traits<const void*>::hash(part)) * 0xC2B2AE3D27D4EB4Full;
+                }
+                return h;
+            }
+        };
+
+        using leak_table = flat_table<leak_id, leak_record, leak_id_traits>;
+
+        struct thread_buffer {
+            registry_mutex lock;
+            error_table errors;
+            key_table pending;
+            std::vector<allocation_key> deleted;
+            /* A bit per hashed address in deleted, it is only searched when the bit is set. */
+            std::array<std::uint64_t, 64> deleted_bits {};
+
+            static std::size_t deleted_bit(const void* addr) {
+                return static_cast<std::size_t>(address_traits<const void*>::hash(addr) >> 52);
+            }
+
+            void stage_deletion(allocation_key key) {
+                const auto bit = deleted_bit(key.data);
+                deleted_bits[bit / 64] |= std::uint64_t { 1 } << (bit % 64);
+                deleted.push_back(std::move(key));
+            }
+
+            bool staged_deletion(const void* addr) const {
+                const auto bit = deleted_bit(addr);
+                if(not (deleted_bits[bit / 64] & (std::uint64_t { 1 } << (bit % 64)))) return false;
+                return std::any_of(deleted.begin(), deleted.end(), [&](const allocation_key& key) { return key.data == addr; });
+            }
+
+            void clear_deleted() {
+                deleted.clear();
+                deleted_bits = {};
+            }
+            usage_table types;
+            usage_table sites;
+            bool in_use = true;
+        };
+
+        static std::size_t shard_capacity(std::size_t capacity) {
+            return (capacity + registry_shards - 1) / registry_shards;
+        }
+
+        static shard& shard_for(void* addr) {
+            const auto bits = reinterpret_cast<std::uintptr_t>(addr);
+            return get().shards[((bits >> 4) ^ (bits >> 12)) & (registry_shards - 1)];
+        }
+
+        static bool recording();
+        static std::optional<bool> delete_tracked(thread_buffer&, void*, type_id, allocation_kind, const data_location&,
+                                                  allocation_key* erased);
+        static void insert_shared(thread_buffer&, allocation_key);
+        static bool delete_global(thread_buffer&, void*);
+        static void log_allocation(void*, type_id, allocation_kind, bool interposed);
+        static std::optional<bool> log_deletion(void*, type_id, allocation_kind, bool checked);
+        static void account(thread_buffer&, const allocation_key&, bool allocated);
+        static void reset_counters();
+        static void flush(thread_buffer&);
+        static bool flush_holding(void*);
+        static void flush_all();
+        static thread_buffer& local_buffer();
+        static void record_error(thread_buffer&, const error_key&, std::size_t count, std::size_t bytes);
+        static void record_error(thread_buffer& buffer, const error_key& error) {
+            record_error(buffer, error, 1, error.key.size);
+        }
+        static std::vector<error_record> collect_errors();
+        static std::vector<leak_record> collect_leaks(generation since = 0);
+        static void write_report(bool leaks, bool errors, generation since = 0);
+        static void clear_buffers(bool keep_pending);
+        static void release_quarantined(const quarantined&);
+        void end_sarif_run();
+        void close_report();
+        void close_report_file();
+
+        static const bool tracking_configured;
         static inline allocation_registry* global_registry = nullptr;
-        std::map<void*, allocation_key> registry_keys;
-        std::vector<allocation_key> deleted_keys {};
-        std::vector<error_key> errors {};
+        static inline bool shut_down = false;
+        static inline std::size_t deleted_capacity = SUIVEUR_DELETED_HISTORY_CAPACITY;
+        static inline eviction_policy deleted_policy = eviction_policy::fifo;
+        static inline std::atomic<std::size_t> quarantine_capacity { quarantine_size };
+        static inline std::atomic<bool> quarantine_protect { false };
+        static inline std::atomic<generation> current_generation { 0 };
+
+        std::array<shard, registry_shards> shards {};
+        registry_mutex buffers_lock;
+        std::vector<std::unique_ptr<thread_buffer>> thread_buffers {};
+        sample_filter unsampled {};
+        source_cache sources {};
+        stack_store stacks {};
+        registry_mutex report_lock;
+        report_buffer report {};
+        report_buffer sarif_results {};
+        report_sink sink = report_sink::to_stream(std::cout);
+        std::FILE* report_file = nullptr;  /* opened from SUIVEUR_REPORT_FILE */
+        report_format format = report_format::text;
+        registry_mutex quarantine_lock;
+        std::deque<quarantined> quarantined_list {};
+        std::size_t quarantined_bytes = 0;
+
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+        registry_atomic<std::int64_t> live_count { 0 };
+        registry_atomic<std::int64_t> live_bytes { 0 };
+        registry_atomic<std::uint64_t> peak_bytes { 0 };
+        registry_atomic<std::uint64_t> total_count { 0 };
+        registry_atomic<std::uint64_t> total_bytes { 0 };
+        registry_atomic<std::uint64_t> total_deletions { 0 };
+        registry_atomic<std::uint64_t> error_sequence { 0 };
+
+        friend struct thread_buffer_handle;
+        friend struct crash_dump;
     };
 
 
@@ -87,58 +376,99 @@ namespace suiveur {
             if(global_registry_ptr) {
                 allocation_registry*& reg = *global_registry_ptr;
                 delete reg;
+                reg = nullptr;
             }
         }
     };
 
 
-    template <typename T>
-    T* register_allocation(T* ptr, const std::size_t line, const char* file) {
-        using U = std::remove_cv_t<T>;
-        auto& types = type_names::get().names;
-        std::size_t type_hash = typeid(U).hash_code();
+    inline allocation_stats stats() {
+        return allocation_registry::stats();
+    }
+
 
-        if(types.count(type_hash) == 0) types[type_hash] = cttypeid<U>{}.name();
-        allocation_registry::record_allocation(ptr, type_hash, line, file);
+    /* The switch is checked here too, so dormant calls don't leave the caller. */
+    template <typename T>
+    T* register_allocation(T* ptr, const call_site* site) {
+        if(not tracking_switch::enabled()) return ptr;
+        allocation_registry::record_allocation(ptr, cttype_id<std::remove_cv_t<T>>, site, sizeof(T));
         return ptr;
     }
 
     template <typename T>
-    T* register_deletion(T* ptr, const std::size_t line, const char* file) {
-        using U = std::remove_cv_t<T>;
-        auto& types = type_names::get().names;
-        std::size_t type_hash = typeid(U).hash_code();
+    T* register_array_allocation(T* ptr, const std::size_t count, const call_site* site) {
+        if(not tracking_switch::enabled()) return ptr;
+        allocation_registry::record_allocation(ptr, cttype_id<std::remove_cv_t<T>>, site, sizeof(T) * count, allocation_kind::array, count);
+        return ptr;
+    }
 
-        if(types.count(type_hash) == 0) types[type_hash] = cttypeid<U>{}.name();
-        allocation_registry::record_deletion(ptr, type_hash, line, file);
+    template <typename T>
+    T* register_deletion(T* ptr, const call_site* site) {
+        if(not tracking_switch::watching()) return ptr;
+        allocation_registry::record_deletion(ptr, cttype_id<std::remove_cv_t<T>>, site);
         return ptr;
     }
 
     template <typename T>
-    T* do_safe_deletion(T* ptr, const std::size_t line, const char* file) {
-        using U = std::remove_cv_t<T>;
-        auto& types = type_names::get().names;
-        std::size_t type_hash = typeid(U).hash_code();
+    T* register_array_deletion(T* ptr, const call_site* site) {
+        if(not tracking_switch::watching()) return ptr;
+        allocation_registry::record_deletion(ptr, cttype_id<std::remove_cv_t<T>>, site, allocation_kind::array);
+        return ptr;
+    }
 
-        if(types.count(type_hash) == 0) types[type_hash] = cttypeid<U>{}.name();
-        auto it = allocation_registry::find_deleted(ptr, type_hash);
+    /* With the quarantine on, the object is destroyed now and its memory released later. */
+    template <typename T>
+    T* do_safe_deletion(T* ptr, const call_site* site) {
+        if(not tracking_switch::watching()) return delete ptr, ptr;
+        allocation_registry::allocation_key erased;
+        bool should_delete = allocation_registry::safe_deletion(ptr, cttype_id<std::remove_cv_t<T>>, site, allocation_kind::scalar,
+                                                                allocation_registry::quarantine_enabled() ? &erased : nullptr);
+        if(not should_delete) return ptr;
+        if constexpr(is_quarantinable_v<T>) {
+            if(erased.data) {
+                ptr->~T();
+                allocation_registry::quarantine(erased, sizeof(T), release_object<T>);
+                return ptr;
+            }
+        }
+        delete ptr;
+        return ptr;
+    }
 
-        bool should_delete = allocation_registry::safe_deletion(ptr, type_hash, line, file);
-        if(should_delete) delete ptr;
+    template <typename T>
+    T* do_safe_array_deletion(T* ptr, const call_site* site) {
+        if(not tracking_switch::watching()) return delete[] ptr, ptr;
+        allocation_registry::allocation_key erased;
+        bool should_delete = allocation_registry::safe_deletion(ptr, cttype_id<std::remove_cv_t<T>>, site, allocation_kind::array,
+                                                                allocation_registry::quarantine_enabled() ? &erased : nullptr);
+        if(not should_delete) return ptr;
+        if constexpr(is_array_quarantinable_v<T>) {
+            if(erased.data) {
+                allocation_registry::quarantine(erased, erased.size, release_array<T>);
+                return ptr;
+            }
+        }
+        delete[] ptr;
         return ptr;
     }
 }
 
 #ifdef ENABLE_MEMORY_REGISTRY
-#   define REGISTER_ALLOC(ptr)      suiveur::register_allocation(ptr, __LINE__, __FILE__)
-#   define REGISTER_DELETE(ptr)     suiveur::register_deletion(ptr, __LINE__, __FILE__)
-#   define SAFE_DELETE(ptr)         suiveur::do_safe_deletion(ptr, __LINE__, __FILE__)
+#   define REGISTER_ALLOC(ptr)      suiveur::register_allocation(ptr, SUIVEUR_CALL_SITE())
+#   define REGISTER_DELETE(ptr)     suiveur::register_deletion(ptr, SUIVEUR_CALL_SITE())
+#   define SAFE_DELETE(ptr)         suiveur::do_safe_deletion(ptr, SUIVEUR_CALL_SITE())
+#   define REGISTER_ALLOC_ARRAY(ptr, count) suiveur::register_array_allocation(ptr, count, SUIVEUR_CALL_SITE())
+#   define REGISTER_DELETE_ARRAY(ptr)       suiveur::register_array_deletion(ptr, SUIVEUR_CALL_SITE())
+#   define SAFE_DELETE_ARRAY(ptr)           suiveur::do_safe_array_deletion(ptr, SUIVEUR_CALL_SITE())
 #   define RESET_REGISTRY()         suiveur::allocation_registry::erase()
 #   define PASS_REGISTRY()          suiveur::allocation_registry::pass()
 #else
 #   define REGISTER_ALLOC(ptr)      (ptr)
 #   define REGISTER_DELETE(ptr)     (ptr)
 #   define SAFE_DELETE(ptr)         (delete ptr)
+#   define REGISTER_ALLOC_ARRAY(ptr, count) (ptr)
+#   define REGISTER_DELETE_ARRAY(ptr)       (ptr)
+#   define SAFE_DELETE_ARRAY(ptr)           (delete[] ptr)
 #   define RESET_REGISTRY()         void(0)
 #   define PASS_REGISTRY()          void(0)
 #endif
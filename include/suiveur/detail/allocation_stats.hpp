@@ -0,0 +1,166 @@
+#ifndef MEMORY_TRACKER_ALLOCATION_STATS_HPP
+#define MEMORY_TRACKER_ALLOCATION_STATS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#if (defined(__x86_64__) or defined(__i386__) or defined(_M_X64)) and (defined(__GNUC__) or defined(_MSC_VER))
+#   define SUIVEUR_HAS_TSC
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#   else
+#       include <x86intrin.h>
+#   endif
+#endif
+
+namespace suiveur {
+    inline std::uint64_t steady_ns() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+#ifdef SUIVEUR_HAS_TSC
+    struct tsc_reading {
+        std::uint64_t ticks = __rdtsc();
+        std::uint64_t ns = steady_ns();
+    };
+#endif
+
+    /*
+     * What allocations are timestamped with. Reads the TSC where there is one, which is cheaper
+     * than the monotonic clock, and converts ticks with the rate measured against it over the
+     * first 100 ms. Elsewhere ticks are monotonic nanoseconds.
+     */
+    struct lifetime_clock {
+        static std::uint64_t now() {
+#ifdef SUIVEUR_HAS_TSC
+            return __rdtsc();
+#else
+            return steady_ns();
+#endif
+        }
+
+        static std::uint64_t to_ns(const std::uint64_t ticks) {
+#ifdef SUIVEUR_HAS_TSC
+            return static_cast<std::uint64_t>(double(ticks) * ns_per_tick());
+#else
+            return ticks;
+#endif
+        }
+
+#ifdef SUIVEUR_HAS_TSC
+    private:
+        /* Zero until initialized, both counters then still run from boot. */
+        static inline const tsc_reading origin {};
+
+        /* Until the rate settles it is measured again every 2^20 ticks, not on every call. */
+        static double ns_per_tick() {
+            static std::atomic<double> settled { 0.0 };
+            static std::atomic<double> provisional { 1.0 };
+            static std::atomic<std::uint64_t> measured_at { 0 };
+            if(const double rate = settled.load(std::memory_order_relaxed); rate > 0) return rate;
+            if(__rdtsc() - measured_at.load(std::memory_order_relaxed) < (std::uint64_t { 1 } << 20)) {
+                return provisional.load(std::memory_order_relaxed);
+            }
+            const tsc_reading current {};
+            if(current.ticks <= origin.ticks) return 1.0;
+            const double rate = double(current.ns - origin.ns) / double(current.ticks - origin.ticks);
+            if(current.ns - origin.ns >= 100'000'000) settled.store(rate, std::memory_order_relaxed);
+            provisional.store(rate, std::memory_order_relaxed);
+            measured_at.store(current.ticks, std::memory_order_relaxed);
+            return rate;
+        }
+#endif
+    };
+
+    /* How long deleted pointers lived. Bucket i counts lifetimes in [2^i, 2^(i+1)) nanoseconds, the last one everything above. */
+    struct lifetime_histogram {
+        static constexpr std::size_t bucket_count = 48;
+
+        std::array<std::size_t, bucket_count> buckets {};
+        std::size_t count = 0;
+        std::uint64_t total_ns = 0;
+
+        static std::size_t bucket_of(std::uint64_t ns) {
+#ifdef __GNUC__
+            const std::size_t bucket = ns > 1 ? 63 - std::size_t(__builtin_clzll(ns)) : 0;
+#else
+            std::size_t bucket = 0;
+            while(ns > 1) {
+                ns >>= 1;
+                ++bucket;
+            }
+#endif
+            return bucket < bucket_count ? bucket : bucket_count - 1;
+        }
+
+        static std::uint64_t bucket_start(const std::size_t bucket) {
+            return bucket == 0 ? 0 : std::uint64_t { 1 } << bucket;
+        }
+
+        void add(const std::uint64_t ns, const std::size_t times = 1) {
+            buckets[bucket_of(ns)] += times;
+            count += times;
+            total_ns += ns * times;
+        }
+
+        void merge(const lifetime_histogram& other) {
+            for(std::size_t bucket = 0; bucket < bucket_count; ++bucket) buckets[bucket] += other.buckets[bucket];
+            count += other.count;
+            total_ns += other.total_ns;
+        }
+
+        [[nodiscard]] double mean_ns() const { return count ? double(total_ns) / double(count) : 0.0; }
+
+        /* Start of the bucket the given fraction of lifetimes falls in, 0.5 for the median. */
+        [[nodiscard]] std::uint64_t percentile(const double fraction) const {
+            if(count == 0) return 0;
+            /* 1.0 lands on the last lifetime, the start of the highest bucket in use. */
+            const auto wanted = std::min(static_cast<std::size_t>(fraction * double(count)), count - 1);
+            std::size_t seen = 0;
+            for(std::size_t bucket = 0; bucket < bucket_count; ++bucket) {
+                seen += buckets[bucket];
+                if(seen > wanted) return bucket_start(bucket);
+            }
+            return 0;
+        }
+    };
+
+    struct usage_stats {
+        std::size_t live_count = 0;
+        std::size_t live_bytes = 0;
+        std::size_t total_count = 0;
+        std::size_t total_bytes = 0;
+        lifetime_histogram lifetimes;
+    };
+
+    struct type_usage : usage_stats {
+        std::string_view type;
+    };
+
+    /* Pointers seen by operator new have no file, only the address they were allocated from. */
+    struct site_usage : usage_stats {
+        const char* file = nullptr;
+        std::size_t line = 0;
+        const void* caller = nullptr;
+    };
+
+    /* Copy of the registry counters, values are estimates when sampling. */
+    struct allocation_stats : usage_stats {
+        std::size_t peak_bytes = 0;
+        std::size_t total_deletions = 0;
+        double elapsed_seconds = 0;
+        double allocation_rate = 0;
+        double byte_rate = 0;
+        std::vector<type_usage> types;
+        std::vector<site_usage> sites;
+    };
+}
+
+#endif //MEMORY_TRACKER_ALLOCATION_STATS_HPP
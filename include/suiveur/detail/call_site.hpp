@@ -0,0 +1,20 @@
+#ifndef MEMORY_TRACKER_CALL_SITE_HPP
+#define MEMORY_TRACKER_CALL_SITE_HPP
+
+#include <cstddef>
+
+namespace suiveur {
+    struct call_site {
+        const char* file;
+        std::size_t line;
+    };
+}
+
+/* Each expansion owns a constant initialized descriptor, nothing is copied per call. */
+#define SUIVEUR_CALL_SITE()                                                     \
+    ([]() -> const ::suiveur::call_site* {                                      \
+        static constexpr ::suiveur::call_site suiveur_site { __FILE__, __LINE__ }; \
+        return &suiveur_site;                                                   \
+    }())
+
+#endif //MEMORY_TRACKER_CALL_SITE_HPP
@@ -0,0 +1,258 @@
+#include "call_stack.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <mutex>
+
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__) or defined(__aarch64__)) \
+    and (defined(__linux__) or defined(__APPLE__))
+#   define SUIVEUR_HAS_FRAME_WALK
+#   include <cstdlib>
+#   include <cxxabi.h>
+#   include <dlfcn.h>
+#   include <pthread.h>
+#endif
+
+namespace suiveur {
+#ifdef SUIVEUR_HAS_FRAME_WALK
+    struct stack_bounds {
+        const std::byte* low = nullptr;
+        const std::byte* top = nullptr;
+    };
+
+    /* The stack of the calling thread, null bounds when they can't be read. */
+    static const stack_bounds& thread_stack() {
+        static thread_local const stack_bounds bounds = [] {
+#   ifdef __APPLE__
+            const auto* top = static_cast<const std::byte*>(pthread_get_stackaddr_np(pthread_self()));
+            return stack_bounds { top - pthread_get_stacksize_np(pthread_self()), top };
+#   else
+            pthread_attr_t attr;
+            if(pthread_getattr_np(pthread_self(), &attr) != 0) return stack_bounds {};
+            void* low = nullptr;
+            std::size_t size = 0;
+            pthread_attr_getstack(&attr, &low, &size);
+            pthread_attr_destroy(&attr);
+            return stack_bounds { static_cast<const std::byte*>(low), static_cast<const std::byte*>(low) + size };
+#   endif
+        }();
+        return bounds;
+    }
+
+    /* Frames of the calling thread all lie below this. */
+    static const std::byte* stack_top() {
+        return thread_stack().top;
+    }
+
+    /* Each frame has to lie above the last one and below the top of the stack, the walk ends at the first that doesn't. */
+    __attribute__((noinline)) std::size_t walk_stack(const void** frames, const std::size_t max, std::size_t skip) {
+        const std::byte* top = stack_top();
+        auto* const* fp = static_cast<void* const*>(__builtin_frame_address(0));
+        std::size_t count = 0;
+        while(top and count < max) {
+            if(reinterpret_cast<const std::byte*>(fp + 2) > top or reinterpret_cast<std::uintptr_t>(fp) % alignof(void*) != 0) break;
+            const void* frame = fp[1];
+            auto* const* next = static_cast<void* const*>(fp[0]);
+            if(not frame) break;
+            if(skip > 0) --skip;
+            else frames[count++] = frame;
+            if(next <= fp) break;
+            fp = next;
+        }
+        return count;
+    }
+
+    /* Modules cover the static data of the program and its libraries. */
+    bool static_or_stack_address(const void* addr) {
+        const auto* byte = static_cast<const std::byte*>(addr);
+        const auto& stack = thread_stack();
+        if(byte >= stack.low and byte < stack.top) return true;
+        Dl_info info {};
+        return dladdr(addr, &info) != 0;
+    }
+#else
+    std::size_t walk_stack(const void**, std::size_t, std::size_t) {
+        return 0;
+    }
+
+    bool static_or_stack_address(const void*) {
+        return false;
+    }
+#endif
+
+    /* Skips itself and its caller, which is inside the registry. */
+    stack_id stack_store::capture(const std::size_t skip) {
+        const void* frames[stack_depth > 0 ? stack_depth : 1];
+        return intern(frames, walk_stack(frames, stack_depth, skip + 2));
+    }
+
+    stack_store::~stack_store() {
+        for(auto& segment : segments) delete[] segment.load(std::memory_order_relaxed);
+    }
+
+    const stack_store::node& stack_store::at(const stack_id id) const {
+        const std::size_t segment = segment_of(id);
+        const std::size_t offset = segment == 0 ? id : id - segment_size(segment);
+        return segments[segment].load(std::memory_order_acquire)[offset];
+    }
+
+    stack_id stack_store::intern(const void* const* frames, const std::size_t count) {
+        if(count == 0) return 0;
+        std::uint64_t hash = count;
+        for(std::size_t idx = 0; idx < count; ++idx) {
+            hash = (hash ^ reinterpret_cast<std::uintptr_t>(frames[idx])) * 0x9E3779B97F4A7C15ull;
+        }
+        /* Slots are picked by the high bits, the low one only keeps the hash from looking empty. */
+        hash |= 1;
+        if(const stack_id id = find(hash, frames, count)) return id;
+
+        std::lock_guard guard { lock };
+        if(const stack_id id = find(hash, frames, count)) return id;
+        stack_id id = 0;
+        for(std::size_t idx = count; idx-- > 0;) {
+            auto [child, added] = children.try_emplace(edge { id, frames[idx] });
+            if(added) {
+                const auto next = static_cast<stack_id>(node_count++);
+                const std::size_t segment = segment_of(next);
+                node* nodes = segments[segment].load(std::memory_order_relaxed);
+                if(not nodes) {
+                    nodes = new node[segment_size(segment)];
+                    segments[segment].store(nodes, std::memory_order_release);
+                }
+                nodes[segment == 0 ? next : next - segment_size(segment)] = node { frames[idx], id, at(id).depth + 1 };
+                child->value = next;
+            }
+            id = child->value;
+        }
+        publish(hash, id);
+        return id;
+    }
+
+    /* The id is published after its nodes, a reader that sees it sees them too. */
+    stack_id stack_store::find(const std::uint64_t hash, const void* const* frames, const std::size_t count) const {
+        const hash_table* table = stacks.load(std::memory_order_acquire);
+        if(not table) return 0;
+        for(std::size_t idx = (hash >> 32) & table->mask;; idx = (idx + 1) & table->mask) {
+            const slot& s = table->slots[idx];
+            const std::uint64_t seen = s.hash.load(std::memory_order_acquire);
+            if(seen == 0) return 0;
+            if(seen != hash) continue;
+            const stack_id id = s.id.load(std::memory_order_acquire);
+            return id != 0 and matches(id, frames, count) ? id : 0;
+        }
+    }
+
+    /* Called with the lock held. Another stack with the same hash just takes over the slot. */
+    void stack_store::publish(const std::uint64_t hash, const stack_id id) {
+        hash_table* table = stacks.load(std::memory_order_relaxed);
+        if(not table or (table->used + 1) * 2 > table->mask + 1) {
+            auto grown = std::make_unique<hash_table>();
+            const std::size_t capacity = table ? (table->mask + 1) * 2 : 1024;
+            grown->mask = capacity - 1;
+            grown->slots = std::make_unique<slot[]>(capacity);
+            if(table) {
+                for(std::size_t idx = 0; idx <= table->mask; ++idx) {
+                    const std::uint64_t h = table->slots[idx].hash.load(std::memory_order_relaxed);
+                    if(h == 0) continue;
+                    std::size_t pos = (h >> 32) & grown->mask;
+                    while(grown->slots[pos].hash.load(std::memory_order_relaxed) != 0) pos = (pos + 1) & grown->mask;
+                    grown->slots[pos].id.store(table->slots[idx].id.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    grown->slots[pos].hash.store(h, std::memory_order_relaxed);
+                }
+                grown->used = table->used;
+            }
+            table = grown.get();
+            tables.push_back(std::move(grown));
+            stacks.store(table, std::memory_order_release);
+        }
+        for(std::size_t idx = (hash >> 32) & table->mask;; idx = (idx + 1) & table->mask) {
+            slot& s = table->slots[idx];
+            const std::uint64_t seen = s.hash.load(std::memory_order_relaxed);
+            if(seen != 0 and seen != hash) continue;
+            s.id.store(id, std::memory_order_release);
+            if(seen == 0) {
+                s.hash.store(hash, std::memory_order_release);
+                ++table->used;
+            }
+            return;
+        }
+    }
+
+    bool stack_store::matches(stack_id id, const void* const* frames, const std::size_t count) const {
+        if(at(id).depth != count) return false;
+        for(std::size_t idx = 0; idx < count; ++idx) {
+            const node& n = at(id);
+            if(n.frame != frames[idx]) return false;
+            id = n.parent;
+        }
+        return true;
+    }
+
+    std::vector<const void*> stack_store::frames(stack_id id) {
+        std::lock_guard guard { lock };
+        std::vector<const void*> out;
+        for(; id != 0 and id < node_count; id = at(id).parent) out.push_back(at(id).frame);
+        return out;
+    }
+
+    /*
+     * Functions of the library, and the replaced operator new and delete. Template functions
+     * carry their return type, only the qualified name before the parameters counts.
+     */
+    static bool is_internal(const std::string_view name) {
+        if(name.rfind("operator new", 0) == 0 or name.rfind("operator delete", 0) == 0) return true;
+        std::size_t depth = 0;
+        std::size_t start = 0;
+        for(std::size_t idx = 0; idx < name.size(); ++idx) {
+            const char c = name[idx];
+            if(c == '<') ++depth;
+            else if(c == '>' and depth > 0) --depth;
+            else if(depth == 0 and c == ' ') start = idx + 1;
+            else if(depth == 0 and c == '(') return name.substr(start, idx - start).rfind("suiveur::", 0) == 0;
+        }
+        return false;
+    }
+
+    static std::string with_offset(std::string name, const std::uintptr_t offset) {
+        char text[24];
+        std::snprintf(text, sizeof(text), "+0x%" PRIxPTR, offset);
+        return name += text;
+    }
+
+    /* Function and offset when the address has a symbol, module and offset when it doesn't. */
+    static stack_store::symbol describe(const void* frame) {
+        stack_store::symbol sym;
+        const auto pc = reinterpret_cast<std::uintptr_t>(frame);
+#ifdef SUIVEUR_HAS_FRAME_WALK
+        /* A return address may already belong to the next function, the call is just before it. */
+        Dl_info info {};
+        if(dladdr(reinterpret_cast<const void*>(pc - 1), &info)) {
+            if(info.dli_sname) {
+                int status = 0;
+                char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+                sym.name = status == 0 ? demangled : info.dli_sname;
+                std::free(demangled);
+                sym.internal = is_internal(sym.name);
+                sym.name = with_offset(std::move(sym.name), pc - reinterpret_cast<std::uintptr_t>(info.dli_saddr));
+                return sym;
+            }
+            if(info.dli_fname) {
+                std::string_view module { info.dli_fname };
+                module = module.substr(module.find_last_of('/') + 1);
+                sym.name = with_offset(std::string { module }, pc - reinterpret_cast<std::uintptr_t>(info.dli_fbase));
+                return sym;
+            }
+        }
+#endif
+        sym.name = with_offset("", pc);
+        sym.name.erase(0, 1);
+        return sym;
+    }
+
+    stack_store::symbol stack_store::symbolize(const void* frame) {
+        std::lock_guard guard { symbols_lock };
+        auto [entry, inserted] = symbols.try_emplace(frame);
+        if(inserted) entry->value = describe(frame);
+        return entry->value;
+    }
+}
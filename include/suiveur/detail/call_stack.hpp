@@ -0,0 +1,138 @@
+#ifndef MEMORY_TRACKER_CALL_STACK_HPP
+#define MEMORY_TRACKER_CALL_STACK_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "flat_table.hpp"
+#include "registry_mutex.hpp"
+
+#ifndef SUIVEUR_STACK_DEPTH
+#   define SUIVEUR_STACK_DEPTH 0
+#endif
+
+namespace suiveur {
+    /* Frames recorded per allocation and deletion, 0 only keeps the site of the macro. */
+    inline constexpr std::size_t stack_depth = SUIVEUR_STACK_DEPTH;
+
+    /* Stacks are interned, records only keep their id. 0 is no stack. */
+    using stack_id = std::uint32_t;
+
+    /* Return addresses from the caller of the caller up, read from the frame pointer chain. */
+    std::size_t walk_stack(const void** frames, std::size_t max, std::size_t skip);
+
+    /* Whether addr lies in a loaded module or on the calling thread's stack, where new never hands out memory. */
+    bool static_or_stack_address(const void* addr);
+
+    /*
+     * Every stack seen, stored as a trie from the outermost frame in, so stacks sharing
+     * callers share nodes and a stack is the id of its innermost node. Addresses are only
+     * turned into names when a report prints them, once per address.
+     */
+    struct stack_store {
+        stack_store() = default;
+        stack_store(const stack_store&) = delete;
+        stack_store& operator=(const stack_store&) = delete;
+        ~stack_store();
+
+        /* Interns the stack of the caller of the function calling capture, skipping skip more frames. */
+#ifdef __GNUC__
+        __attribute__((noinline))
+#endif
+        stack_id capture(std::size_t skip = 0);
+        stack_id intern(const void* const* frames, std::size_t count);
+
+        /* Innermost first. */
+        std::vector<const void*> frames(stack_id id);
+
+        struct symbol {
+            std::string name;
+            bool internal = false;  /* a function of the library itself */
+        };
+
+        symbol symbolize(const void* frame);
+
+    private:
+        struct node {
+            const void* frame = nullptr;
+            stack_id parent = 0;
+            std::uint32_t depth = 0;
+        };
+
+        struct edge {
+            stack_id parent = 0;
+            const void* frame = nullptr;
+
+            friend bool operator==(const edge& lhs, const edge& rhs) { return lhs.parent == rhs.parent and lhs.frame == rhs.frame; }
+            friend bool operator!=(const edge& lhs, const edge& rhs) { return not (lhs == rhs); }
+        };
+
+        struct edge_traits {
+            static constexpr edge empty() { return {}; }
+            static std::uint64_t hash(const edge& e) {
+                return (address_traits<const void*>::hash(e.frame) ^ e.parent) * 0xC2B2AE3D27D4EB4Full;
+            }
+        };
+
+        /*
+         * Nodes never move once added, segment 0 holds the first 1024 and each one after
+         * that as many as all before it, so readers can follow ids without the lock.
+         */
+        static constexpr std::size_t first_segment_bits = 10;
+        static constexpr std::size_t segment_count = 32 - first_segment_bits + 1;
+
+        static std::size_t segment_of(const stack_id id) {
+#ifdef __GNUC__
+            const std::size_t top = id > 0 ? 31 - std::size_t(__builtin_clz(id)) : 0;
+#else
+            std::size_t top = 0;
+            for(stack_id rest = id; rest > 1; rest >>= 1) ++top;
+#endif
+            return top < first_segment_bits ? 0 : top - first_segment_bits + 1;
+        }
+
+        static std::size_t segment_size(const std::size_t segment) {
+            return std::size_t { 1 } << (segment == 0 ? first_segment_bits : segment + first_segment_bits - 1);
+        }
+
+        const node& at(stack_id id) const;
+
+        /*
+         * Whole stacks are hashed first, so a stack seen before is found without walking the trie
+         * or taking the lock. Slots are only ever filled in, a table that grows is copied and the
+         * old one kept until the store goes away, since a reader may still be probing it.
+         */
+        struct slot {
+            std::atomic<std::uint64_t> hash { 0 };
+            std::atomic<stack_id> id { 0 };
+        };
+
+        struct hash_table {
+            std::size_t mask = 0;
+            std::size_t used = 0;
+            std::unique_ptr<slot[]> slots;
+        };
+
+        stack_id find(std::uint64_t hash, const void* const* frames, std::size_t count) const;
+        void publish(std::uint64_t hash, stack_id id);
+
+        bool matches(stack_id id, const void* const* frames, std::size_t count) const;
+
+        registry_mutex lock;
+        std::atomic<node*> segments[segment_count] {};
+        std::size_t node_count = 1;
+        flat_table<edge, stack_id, edge_traits> children;
+        std::atomic<hash_table*> stacks { nullptr };
+        std::vector<std::unique_ptr<hash_table>> tables;
+
+        registry_mutex symbols_lock;
+        flat_table<const void*, symbol> symbols;
+    };
+}
+
+#endif //MEMORY_TRACKER_CALL_STACK_HPP
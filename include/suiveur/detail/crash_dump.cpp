@@ -0,0 +1,260 @@
+#include "crash_dump.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "allocation_registry.hpp"
+#include "event_log.hpp"
+
+namespace suiveur {
+    namespace {
+        using allocation_key = allocation_registry::allocation_key;
+        using error_record = allocation_registry::error_record;
+
+        constexpr int handled_signals[] { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+
+        /* Everything the handler touches is set aside up front. */
+        char dump_path[4096] {};
+        std::atomic<bool> installed { false };
+        std::atomic<bool> dumping { false };
+        struct sigaction previous[std::size(handled_signals)] {};
+        alignas(16) char alternate_stack[std::size_t { 1 } << 16];
+
+        struct dump_writer {
+            int fd = -1;
+            std::size_t used = 0;
+            alignas(event_record) char buffer[std::size_t { 1 } << 16];
+
+            void flush() {
+                for(std::size_t done = 0; done < used;) {
+                    const auto wrote = ::write(fd, buffer + done, used - done);
+                    if(wrote < 0 and errno == EINTR) continue;
+                    if(wrote <= 0) break;
+                    done += static_cast<std::size_t>(wrote);
+                }
+                used = 0;
+            }
+
+            void put(const void* data, std::size_t length) {
+                const auto* bytes = static_cast<const char*>(data);
+                while(length > 0) {
+                    if(used == sizeof(buffer)) flush();
+                    const std::size_t chunk = length < sizeof(buffer) - used ? length : sizeof(buffer) - used;
+                    std::memcpy(buffer + used, bytes, chunk);
+                    used += chunk;
+                    bytes += chunk;
+                    length -= chunk;
+                }
+            }
+        };
+
+        dump_writer writer;
+
+        /* Sites and types defined so far, once it is full the rest are defined again each time. */
+        const void* defined[4096];
+
+        bool first_definition(const void* key) {
+            constexpr std::size_t mask = std::size(defined) - 1;
+            auto idx = static_cast<std::size_t>(address_traits<const void*>::hash(key)) & mask;
+            for(std::size_t probe = 0; probe <= mask; ++probe, idx = (idx + 1) & mask) {
+                if(defined[idx] == key) return false;
+                if(not defined[idx]) return defined[idx] = key, true;
+            }
+            return true;
+        }
+
+        std::uint64_t id_of(const void* ptr) {
+            return reinterpret_cast<std::uintptr_t>(ptr);
+        }
+
+        void define(const event_op op, const void* key) {
+            if(not key or not first_definition(key)) return;
+            event_record def {};
+            def.op = op;
+            def.address = id_of(key);
+            const char* text;
+            if(op == event_op::define_site) {
+                const auto* site = static_cast<const call_site*>(key);
+                text = site->file;
+                def.size = site->line;
+                def.count = std::strlen(text);
+            }
+            else {
+                const auto* type = static_cast<type_id>(key);
+                text = type->name.data();
+                def.size = type->hash;
+                def.count = type->name.size();
+            }
+            static constexpr char padding[sizeof(event_record)] {};
+            writer.put(&def, sizeof(def));
+            writer.put(text, static_cast<std::size_t>(def.count));
+            if(const auto rest = def.count % sizeof(event_record)) writer.put(padding, sizeof(event_record) - rest);
+        }
+
+        void put_live(const allocation_key& key) {
+            event_record record {};
+            record.address = id_of(key.data);
+            record.size = key.size;
+            record.kind = static_cast<std::uint8_t>(key.kind);
+            if(key.interposed) {
+                record.op = event_op::global_allocation;
+                record.site = id_of(key.caller);
+            }
+            else {
+                define(event_op::define_site, key.allocation_point.site);
+                define(event_op::define_type, key.type);
+                record.op = event_op::allocation;
+                record.type = id_of(key.type);
+                record.site = id_of(key.allocation_point.site);
+                record.count = key.count;
+            }
+            writer.put(&record, sizeof(record));
+        }
+
+        void put_error(const error_record& error) {
+            const auto& first = error.first;
+            define(event_op::define_site, first.loc.site);
+            define(event_op::define_site, first.key.allocation_point.site);
+            define(event_op::define_site, first.key.deletion_point.site);
+            define(event_op::define_type, first.key.type);
+            define(event_op::define_type, first.type);
+
+            event_record record {};
+            record.op = event_op::error;
+            record.address = id_of(first.key.data);
+            record.type = id_of(first.key.type);
+            record.site = id_of(first.loc.site);
+            record.size = error.bytes;
+            record.count = error.count;
+            record.kind = static_cast<std::uint8_t>(first.key.kind);
+            record.reserved = static_cast<std::uint16_t>(first.err);
+            record.thread = first.key.interposed;
+            record.timestamp = error.first_seen;
+
+            event_record detail {};
+            detail.op = event_op::error_detail;
+            detail.type = id_of(first.type);
+            detail.site = id_of(first.key.allocation_point.site);
+            detail.address = id_of(first.key.deletion_point.site);
+            detail.size = first.key.size;
+            detail.count = first.key.count;
+            detail.timestamp = id_of(first.key.caller);
+
+            writer.put(&record, sizeof(record));
+            writer.put(&detail, sizeof(detail));
+        }
+    }
+
+    extern "C" void suiveur_crash_handler(const int signal) {
+        const int saved_errno = errno;
+        crash_dump::write();
+        /* The signal is blocked until the handler returns, then it goes to whoever handled it before. */
+        for(std::size_t idx = 0; idx < std::size(handled_signals); ++idx) {
+            if(handled_signals[idx] == signal) sigaction(signal, &previous[idx], nullptr);
+        }
+        errno = saved_errno;
+        raise(signal);
+    }
+
+    bool crash_dump::install(const char* path) {
+        uninstall();
+        std::size_t length = 0;
+        for(const char* c = path; *c; ++c) {
+            char pid[24];
+            const char* piece = c;
+            std::size_t size = 1;
+            if(c[0] == '%' and c[1] == 'p') {
+                size = static_cast<std::size_t>(std::snprintf(pid, sizeof(pid), "%ld", static_cast<long>(::getpid())));
+                piece = pid;
+                ++c;
+            }
+            if(length + size >= sizeof(dump_path)) return false;
+            std::memcpy(dump_path + length, piece, size);
+            length += size;
+        }
+        dump_path[length] = '\0';
+
+        /* A stack overflow on this thread leaves no room for the handler on its own stack. */
+        stack_t current {};
+        if(sigaltstack(nullptr, &current) == 0 and (current.ss_flags & SS_DISABLE)) {
+            stack_t alternate {};
+            alternate.ss_sp = alternate_stack;
+            alternate.ss_size = sizeof(alternate_stack);
+            sigaltstack(&alternate, nullptr);
+        }
+
+        struct sigaction action {};
+        action.sa_handler = suiveur_crash_handler;
+        action.sa_flags = SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        for(std::size_t idx = 0; idx < std::size(handled_signals); ++idx) {
+            sigaction(handled_signals[idx], &action, &previous[idx]);
+        }
+        installed.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void crash_dump::uninstall() {
+        if(not installed.exchange(false, std::memory_order_acq_rel)) return;
+        for(std::size_t idx = 0; idx < std::size(handled_signals); ++idx) {
+            sigaction(handled_signals[idx], &previous[idx], nullptr);
+        }
+    }
+
+    void crash_dump::configure_from_environment() {
+        if(const char* path = std::getenv("SUIVEUR_CRASH_DUMP_FILE"); path and *path) install(path);
+    }
+
+    /* Only one dump is written at a time, a thread crashing while another dumps just goes on to crash. */
+    bool crash_dump::write() {
+        if(not installed.load(std::memory_order_acquire) or dumping.exchange(true, std::memory_order_acq_rel)) return false;
+        writer.fd = ::open(dump_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(writer.fd < 0) {
+            dumping.store(false, std::memory_order_release);
+            return false;
+        }
+        writer.used = 0;
+        std::memset(defined, 0, sizeof(defined));
+
+        const event_log_header header {};
+        writer.put(&header, sizeof(header));
+        if(allocation_registry::global_registry and not allocation_registry::shut_down) {
+            write_live();
+            write_errors();
+        }
+        writer.flush();
+        ::close(writer.fd);
+        writer.fd = -1;
+        dumping.store(false, std::memory_order_release);
+        return true;
+    }
+
+    /* Read without the locks, the thread that crashed may be holding them. */
+    void crash_dump::write_live() {
+        auto& reg = *allocation_registry::global_registry;
+        for(auto& s : reg.shards) {
+            for(const auto& [addr, key] : s.keys) put_live(key);
+        }
+        for(const auto& buffer : reg.thread_buffers) {
+            if(not buffer) continue;
+            for(const auto& [addr, key] : buffer->pending) put_live(key);
+        }
+    }
+
+    void crash_dump::write_errors() {
+        auto& reg = *allocation_registry::global_registry;
+        for(const auto& buffer : reg.thread_buffers) {
+            if(not buffer) continue;
+            for(const auto& [id, error] : buffer->errors) put_error(error);
+        }
+    }
+}
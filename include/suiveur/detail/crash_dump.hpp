@@ -0,0 +1,28 @@
+#ifndef MEMORY_TRACKER_CRASH_DUMP_HPP
+#define MEMORY_TRACKER_CRASH_DUMP_HPP
+
+namespace suiveur {
+    /*
+     * Writes the live pointers and the recorded errors out when the program crashes, in the
+     * event log format so suiveur-analyze can replay them into a report. The handler doesn't
+     * allocate or lock, records go through a static buffer and out with write(2). Other threads
+     * keep running meanwhile, a record they change while it is read may come out torn.
+     */
+    struct crash_dump {
+        /* Handles SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT. "%p" in path is replaced by the process id. */
+        static bool install(const char* path);
+        static void uninstall();
+
+        /* Installs it when SUIVEUR_CRASH_DUMP_FILE is set. */
+        static void configure_from_environment();
+
+        /* Writes the dump to the installed path now, it is safe to call from a signal handler. */
+        static bool write();
+
+    private:
+        static void write_live();
+        static void write_errors();
+    };
+}
+
+#endif //MEMORY_TRACKER_CRASH_DUMP_HPP
@@ -3,6 +3,7 @@
 
 
 #include <array>
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <type_traits>
@@ -59,6 +60,37 @@ namespace suiveur {
     private:
         std::string name_of = { cttypeid<Ty>::pretty_name.data(), cttypeid<Ty>::pretty_name.size() - 1 };
     };
+
+    constexpr std::uint64_t fnv1a(std::string_view str) {
+        std::uint64_t hash = 0xCBF29CE484222325ull;
+        for(char c : str) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    struct type_descriptor {
+        std::string_view name;
+        std::uint64_t hash;
+
+        /* Copies of a descriptor can exist across shared libraries, fall back to the hash. */
+        friend constexpr bool same_type(const type_descriptor* lhs, const type_descriptor* rhs) {
+            return lhs == rhs or (lhs and rhs and lhs->hash == rhs->hash);
+        }
+    };
+
+    using type_id = const type_descriptor*;
+
+    template <typename Ty>
+    struct cttype final : pretty_parse<Ty>
+    {
+        static constexpr std::string_view name = { cttype<Ty>::pretty_name.data(), cttype<Ty>::pretty_name.size() - 1 };
+        static constexpr type_descriptor descriptor = { name, fnv1a(name) };
+    };
+
+    template <typename Ty>
+    inline constexpr type_id cttype_id = &cttype<Ty>::descriptor;
 }
 
 #endif //MEMORY_TRACKER_CTTYPEID_HPP
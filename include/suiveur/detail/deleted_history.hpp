@@ -0,0 +1,104 @@
+#ifndef MEMORY_TRACKER_DELETED_HISTORY_HPP
+#define MEMORY_TRACKER_DELETED_HISTORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "flat_table.hpp"
+
+#ifndef SUIVEUR_DELETED_HISTORY_CAPACITY
+#   define SUIVEUR_DELETED_HISTORY_CAPACITY 65536
+#endif
+
+namespace suiveur {
+    enum class eviction_policy {
+        fifo,
+        lru,
+    };
+
+    struct deleted_id {
+        void* addr = nullptr;
+        std::uint64_t type = 0;
+
+        friend bool operator==(const deleted_id& lhs, const deleted_id& rhs) {
+            return lhs.addr == rhs.addr && lhs.type == rhs.type;
+        }
+        friend bool operator!=(const deleted_id& lhs, const deleted_id& rhs) { return not (lhs == rhs); }
+    };
+
+    struct deleted_id_traits {
+        static constexpr deleted_id empty() { return {}; }
+
+        static std::uint64_t hash(const deleted_id& id) {
+            return address_traits<void*>::hash(id.addr) ^ (id.type * 0xC2B2AE3D27D4EB4Full);
+        }
+    };
+
+    /*
+     * Bounded record of deleted keys, indexed by (address, type).
+     * Once full, the oldest record is evicted. With eviction_policy::lru,
+     * records that were looked up get a second chance (clock) before eviction.
+     */
+    template <typename Key>
+    struct deleted_history {
+        explicit deleted_history(std::size_t capacity = SUIVEUR_DELETED_HISTORY_CAPACITY,
+                                 eviction_policy policy = eviction_policy::fifo)
+                : capacity(capacity ? capacity : 1), policy(policy) {}
+
+        [[nodiscard]] std::size_t size() const { return index.size(); }
+        [[nodiscard]] bool empty() const { return index.empty(); }
+
+        void push(Key key) {
+            const deleted_id id { key.data, key.type->hash };
+            if(auto* e = index.find(id)) ring[e->value].live = false;
+
+            std::size_t pos;
+            if(ring.size() < capacity) {
+                pos = ring.size();
+                ring.push_back({ std::move(key), true, false });
+            }
+            else {
+                while(ring[head].live && ring[head].referenced) {
+                    ring[head].referenced = false;
+                    head = (head + 1) % capacity;
+                }
+                pos = head;
+                head = (head + 1) % capacity;
+                auto& old = ring[pos];
+                if(old.live) index.erase(deleted_id { old.key.data, old.key.type->hash });
+                old = { std::move(key), true, false };
+            }
+            index.try_emplace(id).first->value = pos;
+        }
+
+        const Key* find(void* addr, const std::uint64_t type) {
+            auto* e = index.find(deleted_id { addr, type });
+            if(not e) return nullptr;
+            auto& rec = ring[e->value];
+            if(policy == eviction_policy::lru) rec.referenced = true;
+            return &rec.key;
+        }
+
+        void clear() {
+            ring.clear();
+            index.clear();
+            head = 0;
+        }
+
+    private:
+        struct record {
+            Key key;
+            bool live = false;
+            bool referenced = false;
+        };
+
+        std::vector<record> ring {};
+        flat_table<deleted_id, std::size_t, deleted_id_traits> index {};
+        std::size_t head = 0;
+        std::size_t capacity;
+        eviction_policy policy;
+    };
+}
+
+#endif //MEMORY_TRACKER_DELETED_HISTORY_HPP
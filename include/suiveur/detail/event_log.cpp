@@ -0,0 +1,163 @@
+#include "event_log.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "call_site.hpp"
+#include "cttypeid.hpp"
+#include "flat_table.hpp"
+#include "reentrancy_guard.hpp"
+
+#ifdef _WIN32
+#   include <process.h>
+#   define SUIVEUR_GETPID() _getpid()
+#else
+#   include <unistd.h>
+#   define SUIVEUR_GETPID() ::getpid()
+#endif
+
+namespace suiveur {
+    namespace {
+        std::uint32_t thread_index() {
+            static std::atomic<std::uint32_t> next { 0 };
+            static thread_local const std::uint32_t idx = next.fetch_add(1, std::memory_order_relaxed) + 1;
+            return idx;
+        }
+
+        /* "%p" is replaced by the process id, so each process gets its own log. */
+        std::string expand_path(const char* path) {
+            std::string expanded { path };
+            const auto pid = std::to_string(SUIVEUR_GETPID());
+            for(auto pos = expanded.find("%p"); pos != std::string::npos; pos = expanded.find("%p", pos + pid.size())) {
+                expanded.replace(pos, 2, pid);
+            }
+            return expanded;
+        }
+
+        void write_text(std::FILE* file, const char* text, const std::size_t length) {
+            static constexpr char padding[sizeof(event_record)] {};
+            std::fwrite(text, 1, length, file);
+            if(const auto rest = length % sizeof(event_record)) std::fwrite(padding, 1, sizeof(event_record) - rest, file);
+        }
+
+        struct env_log {
+            env_log() {
+                if(const char* path = std::getenv("SUIVEUR_EVENT_LOG_FILE"); path and *path) event_log::open(path);
+            }
+            ~env_log() { event_log::close(); }
+        };
+
+        const env_log log_from_env {};
+    }
+
+    bool event_log::open(const char* path) {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        close();
+        std::FILE* file = std::fopen(expand_path(path).c_str(), "wb");
+        if(not file) return false;
+        auto* log = new event_log { file };
+        const event_log_header header {};
+        std::fwrite(&header, sizeof(header), 1, file);
+        std::fflush(file);
+        current.store(log, std::memory_order_release);
+        return true;
+    }
+
+    /* Call once no other thread is logging, records pushed concurrently may be lost. */
+    void event_log::close() {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        delete current.exchange(nullptr, std::memory_order_acq_rel);
+    }
+
+    event_log::event_log(std::FILE* file) : slots(std::make_unique<slot[]>(capacity)), file(file) {
+        for(std::size_t idx = 0; idx < capacity; ++idx) slots[idx].sequence.store(idx, std::memory_order_relaxed);
+        std::setvbuf(file, nullptr, _IOFBF, std::size_t { 1 } << 20);
+        writer = std::thread { [this] { run(); } };
+    }
+
+    event_log::~event_log() {
+        stopping.store(true, std::memory_order_release);
+        if(writer.joinable()) writer.join();
+        std::fclose(file);
+    }
+
+    void event_log::push(event_record record) {
+        record.thread = thread_index();
+        record.timestamp = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+
+        std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        for(;;) {
+            auto& s = slots[pos & (capacity - 1)];
+            const auto seq = s.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if(diff == 0) {
+                if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    s.record = record;
+                    s.sequence.store(pos + 1, std::memory_order_release);
+                    return;
+                }
+            }
+            else {
+                /* Full, wait for the writer to free a slot. */
+                if(diff < 0) std::this_thread::yield();
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void event_log::run() {
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        flat_table<const void*, bool> defined;
+
+        auto define = [&](const event_op op, const std::uint64_t id) {
+            const auto* key = reinterpret_cast<const void*>(static_cast<std::uintptr_t>(id));
+            if(not key or not defined.try_emplace(key).second) return;
+            event_record def {};
+            def.op = op;
+            def.address = id;
+            const char* text;
+            if(op == event_op::define_site) {
+                const auto* site = static_cast<const call_site*>(key);
+                text = site->file;
+                def.size = site->line;
+                def.count = std::strlen(text);
+            }
+            else {
+                const auto* type = static_cast<type_id>(key);
+                text = type->name.data();
+                def.size = type->hash;
+                def.count = type->name.size();
+            }
+            std::fwrite(&def, sizeof(def), 1, file);
+            write_text(file, text, static_cast<std::size_t>(def.count));
+        };
+
+        for(;;) {
+            const bool stop = stopping.load(std::memory_order_acquire);
+            std::size_t drained = 0;
+            for(;;) {
+                auto& s = slots[dequeue_pos & (capacity - 1)];
+                if(s.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) break;
+                const event_record record = s.record;
+                s.sequence.store(dequeue_pos + capacity, std::memory_order_release);
+                ++dequeue_pos;
+                ++drained;
+
+                if(record.op == event_op::allocation or record.op == event_op::deletion or record.op == event_op::safe_deletion) {
+                    define(event_op::define_site, record.site);
+                    define(event_op::define_type, record.type);
+                }
+                std::fwrite(&record, sizeof(record), 1, file);
+            }
+            if(drained == 0) {
+                if(stop) break;
+                std::fflush(file);
+                std::this_thread::sleep_for(std::chrono::milliseconds { 1 });
+            }
+        }
+        std::fflush(file);
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef MEMORY_TRACKER_EVENT_LOG_HPP
+#define MEMORY_TRACKER_EVENT_LOG_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+#ifndef SUIVEUR_EVENT_LOG_CAPACITY
+#   define SUIVEUR_EVENT_LOG_CAPACITY 65536
+#endif
+
+namespace suiveur {
+    enum class event_op : std::uint8_t {
+        allocation,
+        deletion,
+        safe_deletion,
+        global_allocation,
+        global_deletion,
+        reset,
+        pass,
+        define_site,
+        define_type,
+        error,
+        error_detail,
+    };
+
+    /*
+     * Fixed size record of one registry call. Sites and types are identified by
+     * the address of their descriptor, the first record using one is preceded
+     * by a define_site/define_type record followed by the text it names.
+     * For definitions, size holds the line or type hash and count the text length.
+     * Crash dumps also hold recorded errors, each an error record (address, type,
+     * site of the error, kind, bytes in size, occurrences in count, error type in
+     * reserved, thread set when interposed, order seen in timestamp) followed by an error_detail record (the
+     * other type, allocation site in site, deletion site in address, size, count,
+     * caller in timestamp).
+     */
+    struct event_record {
+        std::uint64_t address = 0;
+        std::uint64_t type = 0;
+        std::uint64_t site = 0;
+        std::uint64_t size = 0;
+        std::uint64_t count = 0;
+        std::uint64_t timestamp = 0;
+        std::uint32_t thread = 0;
+        event_op op = event_op::allocation;
+        std::uint8_t kind = 0;
+        std::uint16_t reserved = 0;
+    };
+
+    static_assert(sizeof(event_record) == 56, "event_record is written to disk as is.");
+
+    struct event_log_header {
+        char magic[8] = { 'S', 'U', 'I', 'V', 'E', 'V', 'T', '1' };
+        std::uint32_t record_size = sizeof(event_record);
+        std::uint32_t reserved = 0;
+    };
+
+    /*
+     * Streams registry calls to a file instead of tracking them in process.
+     * Producers claim slots of a bounded lock-free ring, a background thread
+     * drains it and writes the records out.
+     */
+    struct event_log {
+        static constexpr std::size_t capacity = SUIVEUR_EVENT_LOG_CAPACITY;
+        static_assert((capacity & (capacity - 1)) == 0, "SUIVEUR_EVENT_LOG_CAPACITY must be a power of two.");
+
+        static bool open(const char* path);
+        static void close();
+        static event_log* active() { return current.load(std::memory_order_acquire); }
+
+        void push(event_record record);
+
+        ~event_log();
+
+    private:
+        struct alignas(64) slot {
+            std::atomic<std::size_t> sequence { 0 };
+            event_record record;
+        };
+
+        explicit event_log(std::FILE* file);
+        void run();
+
+        static inline std::atomic<event_log*> current { nullptr };
+
+        std::unique_ptr<slot[]> slots;
+        alignas(64) std::atomic<std::size_t> enqueue_pos { 0 };
+        alignas(64) std::size_t dequeue_pos = 0;
+        std::atomic<bool> stopping { false };
+        std::FILE* file;
+        std::thread writer;
+    };
+}
+
+#endif //MEMORY_TRACKER_EVENT_LOG_HPP
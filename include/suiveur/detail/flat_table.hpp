@@ -0,0 +1,167 @@
+#ifndef MEMORY_TRACKER_FLAT_TABLE_HPP
+#define MEMORY_TRACKER_FLAT_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace suiveur {
+    /* Alignment leaves the low bits of heap pointers zeroed, drop them before mixing. */
+    template <typename Key>
+    struct address_traits {
+        static constexpr Key empty() { return nullptr; }
+
+        static std::uint64_t hash(const Key key) {
+            const auto addr = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key));
+            return (addr >> 3) * 0x9E3779B97F4A7C15ull;
+        }
+    };
+
+    /* Linear probing, erasure shifts the cluster back instead of leaving tombstones. */
+    template <typename Key, typename Value, typename Traits = address_traits<Key>>
+    struct flat_table {
+        struct entry {
+            Key key = Traits::empty();
+            Value value {};
+        };
+
+        template <typename E>
+        struct basic_iterator {
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = entry;
+            using difference_type = std::ptrdiff_t;
+            using pointer = E*;
+            using reference = E&;
+
+            E* pos = nullptr;
+            E* last = nullptr;
+
+            basic_iterator() = default;
+            basic_iterator(E* pos, E* last) : pos(pos), last(last) { skip(); }
+
+            reference operator*() const { return *pos; }
+            pointer operator->() const { return pos; }
+            basic_iterator& operator++() { ++pos; skip(); return *this; }
+            basic_iterator operator++(int) { auto tmp = *this; ++*this; return tmp; }
+            friend bool operator==(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.pos == rhs.pos; }
+            friend bool operator!=(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.pos != rhs.pos; }
+
+        private:
+            void skip() {
+                while(pos != last && pos->key == Traits::empty()) ++pos;
+            }
+        };
+
+        using iterator = basic_iterator<entry>;
+        using const_iterator = basic_iterator<const entry>;
+
+        flat_table() = default;
+        explicit flat_table(std::size_t expected) { reserve(expected); }
+
+        [[nodiscard]] std::size_t size() const { return count; }
+        [[nodiscard]] bool empty() const { return count == 0; }
+        [[nodiscard]] std::size_t capacity() const { return slots.size(); }
+
+        iterator begin() { return { slots.data(), slots.data() + slots.size() }; }
+        iterator end() { return { slots.data() + slots.size(), slots.data() + slots.size() }; }
+        const_iterator begin() const { return { slots.data(), slots.data() + slots.size() }; }
+        const_iterator end() const { return { slots.data() + slots.size(), slots.data() + slots.size() }; }
+
+        entry* find(const Key& key) {
+            if(count == 0) return nullptr;
+            const std::size_t mask = slots.size() - 1;
+            for(std::size_t idx = home(key); ; idx = (idx + 1) & mask) {
+                entry& e = slots[idx];
+                if(e.key == key) return &e;
+                if(e.key == Traits::empty()) return nullptr;
+            }
+        }
+
+        const entry* find(const Key& key) const {
+            return const_cast<flat_table*>(this)->find(key);
+        }
+
+        /* Returns the entry for key, inserting a default value if it was absent. */
+        std::pair<entry*, bool> try_emplace(const Key& key) {
+            if((count + 1) * 4 > slots.size() * 3) grow();
+            const std::size_t mask = slots.size() - 1;
+            for(std::size_t idx = home(key); ; idx = (idx + 1) & mask) {
+                entry& e = slots[idx];
+                if(e.key == key) return { &e, false };
+                if(e.key == Traits::empty()) {
+                    e.key = key;
+                    ++count;
+                    return { &e, true };
+                }
+            }
+        }
+
+        bool erase(const Key& key) {
+            entry* e = find(key);
+            if(not e) return false;
+            erase(e);
+            return true;
+        }
+
+        void erase(entry* e) {
+            const std::size_t mask = slots.size() - 1;
+            std::size_t hole = static_cast<std::size_t>(e - slots.data());
+            for(std::size_t idx = (hole + 1) & mask; ; idx = (idx + 1) & mask) {
+                entry& next = slots[idx];
+                if(next.key == Traits::empty()) break;
+                const std::size_t ideal = home(next.key);
+                if(((idx - ideal) & mask) >= ((idx - hole) & mask)) {
+                    slots[hole] = std::move(next);
+                    hole = idx;
+                }
+            }
+            slots[hole] = entry {};
+            --count;
+        }
+
+        void clear() {
+            for(auto& e : slots) e = entry {};
+            count = 0;
+        }
+
+        void reserve(std::size_t expected) {
+            std::size_t wanted = min_capacity;
+            while(wanted * 3 < expected * 4) wanted *= 2;
+            if(wanted > slots.size()) rehash(wanted);
+        }
+
+    private:
+        static constexpr std::size_t min_capacity = 16;
+
+        std::size_t home(const Key& key) const {
+            return static_cast<std::size_t>(Traits::hash(key) >> shift);
+        }
+
+        void grow() {
+            rehash(slots.empty() ? min_capacity : slots.size() * 2);
+        }
+
+        void rehash(std::size_t new_capacity) {
+            std::vector<entry> old(new_capacity);
+            old.swap(slots);
+            shift = 64;
+            for(std::size_t cap = new_capacity; cap > 1; cap >>= 1) --shift;
+
+            const std::size_t mask = slots.size() - 1;
+            for(auto& e : old) {
+                if(e.key == Traits::empty()) continue;
+                std::size_t idx = home(e.key);
+                while(slots[idx].key != Traits::empty()) idx = (idx + 1) & mask;
+                slots[idx] = std::move(e);
+            }
+        }
+
+        std::vector<entry> slots {};
+        std::size_t count = 0;
+        unsigned shift = 64;
+    };
+}
+
+#endif //MEMORY_TRACKER_FLAT_TABLE_HPP
@@ -0,0 +1,142 @@
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "allocation_registry.hpp"
+
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#   define SUIVEUR_RETURN_ADDRESS() _ReturnAddress()
+#else
+#   define SUIVEUR_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+namespace {
+    using suiveur::allocation_kind;
+    using suiveur::allocation_registry;
+
+    void* allocate(std::size_t size) {
+        if(size == 0) size = 1;
+        for(;;) {
+            if(void* ptr = std::malloc(size)) return ptr;
+            std::new_handler handler = std::get_new_handler();
+            if(not handler) throw std::bad_alloc {};
+            handler();
+        }
+    }
+
+    void* allocate(std::size_t size, std::align_val_t al) {
+        const auto align = static_cast<std::size_t>(al);
+        /* aligned_alloc wants a multiple of the alignment, rounding up must not wrap around. */
+        if(size > SIZE_MAX - align) throw std::bad_alloc {};
+        size = (size + align - 1) & ~(align - 1);
+        if(size == 0) size = align;
+        for(;;) {
+#if defined(_MSC_VER)
+            if(void* ptr = _aligned_malloc(size, align)) return ptr;
+#else
+            if(void* ptr = std::aligned_alloc(align, size)) return ptr;
+#endif
+            std::new_handler handler = std::get_new_handler();
+            if(not handler) throw std::bad_alloc {};
+            handler();
+        }
+    }
+
+    void release(void* ptr) noexcept {
+        std::free(ptr);
+    }
+
+    void release(void* ptr, std::align_val_t) noexcept {
+#if defined(_MSC_VER)
+        _aligned_free(ptr);
+#else
+        std::free(ptr);
+#endif
+    }
+
+    template <typename...TT>
+    void* tracked_new(const allocation_kind kind, const void* caller, std::size_t size, TT...tt) {
+        void* ptr = allocate(size, tt...);
+        allocation_registry::record_global_allocation(ptr, size, kind, caller);
+        return ptr;
+    }
+
+    template <typename...TT>
+    void* tracked_new_nothrow(const allocation_kind kind, const void* caller, std::size_t size, TT...tt) noexcept {
+        void* ptr;
+        try { ptr = allocate(size, tt...); }
+        catch(...) { return nullptr; }
+        allocation_registry::record_global_allocation(ptr, size, kind, caller);
+        return ptr;
+    }
+
+    template <typename...TT>
+    void tracked_delete(const allocation_kind kind, void* ptr, TT...tt) noexcept {
+        if(not ptr) return;
+        allocation_registry::record_global_deletion(ptr, kind);
+        release(ptr, tt...);
+    }
+}
+
+void* operator new(std::size_t size) {
+    return tracked_new(allocation_kind::scalar, SUIVEUR_RETURN_ADDRESS(), size);
+}
+void* operator new[](std::size_t size) {
+    return tracked_new(allocation_kind::array, SUIVEUR_RETURN_ADDRESS(), size);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return tracked_new_nothrow(allocation_kind::scalar, SUIVEUR_RETURN_ADDRESS(), size);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return tracked_new_nothrow(allocation_kind::array, SUIVEUR_RETURN_ADDRESS(), size);
+}
+void* operator new(std::size_t size, std::align_val_t al) {
+    return tracked_new(allocation_kind::scalar, SUIVEUR_RETURN_ADDRESS(), size, al);
+}
+void* operator new[](std::size_t size, std::align_val_t al) {
+    return tracked_new(allocation_kind::array, SUIVEUR_RETURN_ADDRESS(), size, al);
+}
+void* operator new(std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return tracked_new_nothrow(allocation_kind::scalar, SUIVEUR_RETURN_ADDRESS(), size, al);
+}
+void* operator new[](std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return tracked_new_nothrow(allocation_kind::array, SUIVEUR_RETURN_ADDRESS(), size, al);
+}
+
+void operator delete(void* ptr) noexcept {
+    tracked_delete(allocation_kind::scalar, ptr);
+}
+void operator delete[](void* ptr) noexcept {
+    tracked_delete(allocation_kind::array, ptr);
+}
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    tracked_delete(allocation_kind::scalar, ptr);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    tracked_delete(allocation_kind::array, ptr);
+}
+void operator delete(void* ptr, std::size_t) noexcept {
+    tracked_delete(allocation_kind::scalar, ptr);
+}
+void operator delete[](void* ptr, std::size_t) noexcept {
+    tracked_delete(allocation_kind::array, ptr);
+}
+void operator delete(void* ptr, std::align_val_t al) noexcept {
+    tracked_delete(allocation_kind::scalar, ptr, al);
+}
+void operator delete[](void* ptr, std::align_val_t al) noexcept {
+    tracked_delete(allocation_kind::array, ptr, al);
+}
+void operator delete(void* ptr, std::size_t, std::align_val_t al) noexcept {
+    tracked_delete(allocation_kind::scalar, ptr, al);
+}
+void operator delete[](void* ptr, std::size_t, std::align_val_t al) noexcept {
+    tracked_delete(allocation_kind::array, ptr, al);
+}
+void operator delete(void* ptr, std::align_val_t al, const std::nothrow_t&) noexcept {
+    tracked_delete(allocation_kind::scalar, ptr, al);
+}
+void operator delete[](void* ptr, std::align_val_t al, const std::nothrow_t&) noexcept {
+    tracked_delete(allocation_kind::array, ptr, al);
+}
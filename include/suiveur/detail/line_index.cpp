@@ -0,0 +1,96 @@
+#include "line_index.hpp"
+
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#   include <immintrin.h>
+#   define SUIVEUR_X86_SIMD
+#endif
+
+namespace suiveur {
+    namespace {
+        using index_fn = std::size_t (*)(const char*, std::size_t, std::size_t, std::vector<std::uint32_t>&, std::size_t);
+
+        std::size_t index_scalar(const char* data, const std::size_t size, std::size_t pos,
+                                 std::vector<std::uint32_t>& starts, const std::size_t limit) {
+            while(pos < size and starts.size() < limit) {
+                const auto* found = static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+                if(not found) return size;
+                pos = static_cast<std::size_t>(found - data) + 1;
+                starts.push_back(static_cast<std::uint32_t>(pos));
+            }
+            return pos;
+        }
+
+#ifdef SUIVEUR_X86_SIMD
+        void push_mask(std::uint64_t mask, const std::size_t base, std::vector<std::uint32_t>& starts) {
+            while(mask) {
+                starts.push_back(static_cast<std::uint32_t>(base + __builtin_ctzll(mask) + 1));
+                mask &= mask - 1;
+            }
+        }
+
+        std::size_t index_sse2(const char* data, const std::size_t size, std::size_t pos,
+                               std::vector<std::uint32_t>& starts, const std::size_t limit) {
+            const __m128i newline = _mm_set1_epi8('\n');
+            for(; pos + 16 <= size and starts.size() < limit; pos += 16) {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                push_mask(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline))), pos, starts);
+            }
+            return index_scalar(data, size, pos, starts, limit);
+        }
+
+        __attribute__((target("avx2")))
+        std::size_t index_avx2(const char* data, const std::size_t size, std::size_t pos,
+                               std::vector<std::uint32_t>& starts, const std::size_t limit) {
+            const __m256i newline = _mm256_set1_epi8('\n');
+            for(; pos + 64 <= size and starts.size() < limit; pos += 64) {
+                const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+                const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + 32));
+                const auto low_mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, newline)));
+                const auto high_mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, newline)));
+                push_mask(low_mask | (std::uint64_t { high_mask } << 32), pos, starts);
+            }
+            return index_sse2(data, size, pos, starts, limit);
+        }
+#endif
+
+        struct dispatch {
+            index_fn fn;
+            const char* isa;
+        };
+
+        dispatch select_index() {
+#ifdef SUIVEUR_X86_SIMD
+            __builtin_cpu_init();
+            if(__builtin_cpu_supports("avx2")) return { index_avx2, "avx2" };
+            return { index_sse2, "sse2" };
+#else
+            return { index_scalar, "scalar" };
+#endif
+        }
+
+        const dispatch& selected() {
+            static const dispatch chosen = select_index();
+            return chosen;
+        }
+    }
+
+    std::size_t index_lines(const std::string_view data, const std::size_t from, std::vector<std::uint32_t>& starts,
+                            const std::size_t limit) {
+        return selected().fn(data.data(), data.size(), from, starts, limit);
+    }
+
+    std::string_view line_at(const std::string_view data, const std::vector<std::uint32_t>& starts, const std::size_t idx) {
+        if(idx >= starts.size()) return {};
+        const std::size_t begin = starts[idx];
+        std::size_t end = idx + 1 < starts.size() ? starts[idx + 1] - 1 : data.size();
+        if(begin > end) return {};
+        if(end > begin and data[end - 1] == '\r') --end;
+        return data.substr(begin, end - begin);
+    }
+
+    const char* line_index_isa() {
+        return selected().isa;
+    }
+}
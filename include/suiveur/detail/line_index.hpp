@@ -0,0 +1,26 @@
+#ifndef MEMORY_TRACKER_LINE_INDEX_HPP
+#define MEMORY_TRACKER_LINE_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+namespace suiveur {
+    /*
+     * Appends the offset following every '\n' in data, starting the scan at from.
+     * Stops once starts holds limit offsets, returns how far the data was scanned.
+     * Offsets are 32 bits, data must be smaller than 4GiB.
+     */
+    std::size_t index_lines(std::string_view data, std::size_t from, std::vector<std::uint32_t>& starts,
+                            std::size_t limit = std::numeric_limits<std::size_t>::max());
+
+    /* Line idx of an index starting with 0, without its "\n" or "\r\n". */
+    std::string_view line_at(std::string_view data, const std::vector<std::uint32_t>& starts, std::size_t idx);
+
+    /* Instruction set picked at runtime for index_lines. */
+    const char* line_index_isa();
+}
+
+#endif //MEMORY_TRACKER_LINE_INDEX_HPP
@@ -1,6 +1,5 @@
 #include "load_file.hpp"
 #include <fstream>
-#include <iterator>
 
 namespace suiveur {
     template <typename Facet>
@@ -34,8 +33,8 @@ namespace suiveur {
         size = is.tellg();
         is.seekg(0, std::ios::beg);
 
-        std::istream_iterator<char> start(is), end;
-        internal_file_data.reserve(size);
-        internal_file_data.insert(internal_file_data.cbegin(), start, end);
+        internal_file_data.insert(0, static_cast<std::size_t>(size), '\0');
+        is.read(internal_file_data.data(), size);
+        internal_file_data.erase(static_cast<std::size_t>(is.gcount()), static_cast<std::size_t>(size - is.gcount()));
     }
 }
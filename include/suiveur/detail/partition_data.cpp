@@ -1,19 +1,16 @@
 #include "partition_data.hpp"
 #include <string_view>
 
+#include "line_index.hpp"
+
 namespace suiveur {
     std::vector<std::string_view> partition_data(const std::string& data) {
-        std::size_t pos = 0, off;
-        std::vector<std::string_view> views;
-        const char* under = data.data();
+        std::vector<std::uint32_t> starts { 0 };
+        index_lines(data, 0, starts);
 
-        while((off = data.find('\n', pos)) != std::string::npos) {
-            const char* begin = under + pos;
-            std::size_t distance = off - pos;
-            views.emplace_back(begin, distance);
-            pos = off + 1;
-        }
-        views.emplace_back(under + pos, data.size() - pos);
+        std::vector<std::string_view> views;
+        views.reserve(starts.size());
+        for(std::size_t idx = 0; idx < starts.size(); ++idx) views.push_back(line_at(data, starts, idx));
         return views;
     }
 }
@@ -0,0 +1,56 @@
+#include "quarantine.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#   include <sys/mman.h>
+#   include <unistd.h>
+#   define SUIVEUR_HAS_MPROTECT
+#endif
+
+namespace suiveur {
+    void poison(void* addr, const std::size_t size) {
+        std::memset(addr, poison_byte, size);
+    }
+
+    std::size_t find_unpoisoned(const void* addr, const std::size_t size) {
+        constexpr std::uint64_t pattern = 0x0101010101010101ull * poison_byte;
+        const auto* bytes = static_cast<const unsigned char*>(addr);
+        std::size_t idx = 0;
+        for(; idx + sizeof(pattern) <= size; idx += sizeof(pattern)) {
+            std::uint64_t word;
+            std::memcpy(&word, bytes + idx, sizeof(word));
+            if(word != pattern) break;
+        }
+        for(; idx < size; ++idx) {
+            if(bytes[idx] != poison_byte) return idx;
+        }
+        return size;
+    }
+
+#ifdef SUIVEUR_HAS_MPROTECT
+    /* The whole pages inside [addr, addr + size), empty when the range doesn't cover one. */
+    static std::pair<std::uintptr_t, std::uintptr_t> inner_pages(void* addr, const std::size_t size) {
+        static const auto page = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+        const auto begin = reinterpret_cast<std::uintptr_t>(addr);
+        const auto first = (begin + page - 1) & ~(page - 1);
+        const auto last = (begin + size) & ~(page - 1);
+        return { first, last > first ? last : first };
+    }
+
+    bool protect_pages(void* addr, const std::size_t size) {
+        const auto [first, last] = inner_pages(addr, size);
+        if(first == last) return false;
+        return ::mprotect(reinterpret_cast<void*>(first), last - first, PROT_NONE) == 0;
+    }
+
+    void unprotect_pages(void* addr, const std::size_t size) {
+        const auto [first, last] = inner_pages(addr, size);
+        if(first != last) ::mprotect(reinterpret_cast<void*>(first), last - first, PROT_READ | PROT_WRITE);
+    }
+#else
+    bool protect_pages(void*, std::size_t) { return false; }
+    void unprotect_pages(void*, std::size_t) {}
+#endif
+}
@@ -0,0 +1,69 @@
+#ifndef MEMORY_TRACKER_QUARANTINE_HPP
+#define MEMORY_TRACKER_QUARANTINE_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifndef SUIVEUR_QUARANTINE_SIZE
+#   define SUIVEUR_QUARANTINE_SIZE 0
+#endif
+
+namespace suiveur {
+    /* Bytes of deleted memory held back from the allocator by default, 0 frees it immediately. */
+    inline constexpr std::size_t quarantine_size = SUIVEUR_QUARANTINE_SIZE;
+
+    /* Deleted memory is filled with this while it waits in quarantine. */
+    inline constexpr unsigned char poison_byte = 0xDD;
+
+    void poison(void* addr, std::size_t size);
+
+    /* Offset of the first byte no longer holding the poison, size if they all do. */
+    std::size_t find_unpoisoned(const void* addr, std::size_t size);
+
+    /* Pages lying entirely inside the range are made inaccessible, returns whether there were any. */
+    bool protect_pages(void* addr, std::size_t size);
+    void unprotect_pages(void* addr, std::size_t size);
+
+    using release_function = void(*)(void*);
+
+    template <typename T, typename = void>
+    struct has_class_delete : std::false_type {};
+
+    template <typename T>
+    struct has_class_delete<T, std::void_t<decltype(T::operator delete(std::declval<void*>()))>> : std::true_type {};
+
+    template <typename T, typename = void>
+    struct has_sized_class_delete : std::false_type {};
+
+    template <typename T>
+    struct has_sized_class_delete<T, std::void_t<decltype(T::operator delete(std::declval<void*>(), sizeof(T)))>> : std::true_type {};
+
+    /*
+     * Objects whose memory can be destroyed now and handed back to the global operator delete later.
+     * Virtual destructors may be freeing a larger derived object, and class operators delete
+     * may not come from the global heap at all.
+     */
+    template <typename T>
+    inline constexpr bool is_quarantinable_v = not std::has_virtual_destructor_v<T>
+            and not has_class_delete<T>::value and not has_sized_class_delete<T>::value;
+
+    /* Arrays of types with destructors carry a cookie in front of the pointer. */
+    template <typename T>
+    inline constexpr bool is_array_quarantinable_v = is_quarantinable_v<T> and std::is_trivially_destructible_v<T>;
+
+    template <typename T>
+    void release_object(void* addr) {
+        if constexpr(alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) ::operator delete(addr, std::align_val_t { alignof(T) });
+        else ::operator delete(addr);
+    }
+
+    template <typename T>
+    void release_array(void* addr) {
+        if constexpr(alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) ::operator delete[](addr, std::align_val_t { alignof(T) });
+        else ::operator delete[](addr);
+    }
+}
+
+#endif //MEMORY_TRACKER_QUARANTINE_HPP
@@ -0,0 +1,34 @@
+#ifndef MEMORY_TRACKER_REENTRANCY_GUARD_HPP
+#define MEMORY_TRACKER_REENTRANCY_GUARD_HPP
+
+namespace suiveur {
+#ifdef SUIVEUR_TRACK_GLOBAL_NEW
+    inline constexpr bool track_global_new = true;
+#else
+    inline constexpr bool track_global_new = false;
+#endif
+
+    /* Allocations made by operator new while a guard is alive on the thread aren't tracked. */
+    struct reentrancy_guard {
+        reentrancy_guard() noexcept {
+            if constexpr(track_global_new) {
+                was_active = active;
+                active = true;
+            }
+        }
+
+        ~reentrancy_guard() {
+            if constexpr(track_global_new) active = was_active;
+        }
+
+        reentrancy_guard(const reentrancy_guard&) = delete;
+        reentrancy_guard& operator=(const reentrancy_guard&) = delete;
+
+        static inline thread_local bool active = false;
+
+    private:
+        bool was_active = false;
+    };
+}
+
+#endif //MEMORY_TRACKER_REENTRANCY_GUARD_HPP
@@ -0,0 +1,71 @@
+#ifndef MEMORY_TRACKER_REGISTRY_MUTEX_HPP
+#define MEMORY_TRACKER_REGISTRY_MUTEX_HPP
+
+#include <atomic>
+#include <cstddef>
+
+#ifdef SUIVEUR_THREAD_SAFE
+#   include <mutex>
+#endif
+
+#ifndef SUIVEUR_REGISTRY_SHARDS
+#   ifdef SUIVEUR_THREAD_SAFE
+#       define SUIVEUR_REGISTRY_SHARDS 64
+#   else
+#       define SUIVEUR_REGISTRY_SHARDS 1
+#   endif
+#endif
+
+#ifndef SUIVEUR_THREAD_CACHE_SIZE
+#   ifdef SUIVEUR_THREAD_SAFE
+#       define SUIVEUR_THREAD_CACHE_SIZE 256
+#   else
+#       define SUIVEUR_THREAD_CACHE_SIZE 0
+#   endif
+#endif
+
+namespace suiveur {
+    struct null_mutex {
+        constexpr void lock() noexcept {}
+        constexpr void unlock() noexcept {}
+        constexpr bool try_lock() noexcept { return true; }
+    };
+
+    /* Counters kept as plain integers when a single thread updates them, std::atomic's interface. */
+    template <typename T>
+    struct null_atomic {
+        T value {};
+
+        constexpr null_atomic() noexcept = default;
+        constexpr null_atomic(const T value) noexcept : value(value) {}
+
+        T load(std::memory_order = std::memory_order_seq_cst) const noexcept { return value; }
+        void store(const T desired, std::memory_order = std::memory_order_seq_cst) noexcept { value = desired; }
+        T fetch_add(const T arg, std::memory_order = std::memory_order_seq_cst) noexcept { const T old = value; value += arg; return old; }
+        T fetch_sub(const T arg, std::memory_order = std::memory_order_seq_cst) noexcept { const T old = value; value -= arg; return old; }
+
+        bool compare_exchange_weak(T& expected, const T desired, std::memory_order = std::memory_order_seq_cst) noexcept {
+            if(value != expected) return expected = value, false;
+            value = desired;
+            return true;
+        }
+    };
+
+#ifdef SUIVEUR_THREAD_SAFE
+    using registry_mutex = std::mutex;
+    template <typename T>
+    using registry_atomic = std::atomic<T>;
+    inline constexpr bool thread_safe = true;
+#else
+    using registry_mutex = null_mutex;
+    template <typename T>
+    using registry_atomic = null_atomic<T>;
+    inline constexpr bool thread_safe = false;
+#endif
+
+    inline constexpr std::size_t registry_shards = SUIVEUR_REGISTRY_SHARDS;
+    inline constexpr std::size_t thread_cache_size = SUIVEUR_THREAD_CACHE_SIZE;
+    static_assert((registry_shards & (registry_shards - 1)) == 0, "SUIVEUR_REGISTRY_SHARDS must be a power of two.");
+}
+
+#endif //MEMORY_TRACKER_REGISTRY_MUTEX_HPP
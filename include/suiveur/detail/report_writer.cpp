@@ -0,0 +1,142 @@
+#include "report_writer.hpp"
+
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <ostream>
+
+#ifdef _WIN32
+#   include <io.h>
+#else
+#   include <unistd.h>
+#endif
+
+namespace suiveur {
+    std::optional<report_format> parse_report_format(const std::string_view name) {
+        if(name == "text") return report_format::text;
+        if(name == "json" or name == "jsonl") return report_format::json_lines;
+        if(name == "sarif") return report_format::sarif;
+        return std::nullopt;
+    }
+
+    report_sink report_sink::to_fd(const int fd) {
+        report_sink sink;
+        sink.kind = sink_kind::fd;
+        sink.fd = fd;
+        return sink;
+    }
+
+    report_sink report_sink::to_file(std::FILE* file) {
+        report_sink sink;
+        sink.kind = sink_kind::file;
+        sink.file = file;
+        return sink;
+    }
+
+    report_sink report_sink::to_stream(std::ostream& os) {
+        report_sink sink;
+        sink.kind = sink_kind::stream;
+        sink.stream = &os;
+        return sink;
+    }
+
+    report_sink report_sink::to_callback(callback_type callback) {
+        report_sink sink;
+        sink.kind = sink_kind::callback;
+        sink.callback = std::move(callback);
+        return sink;
+    }
+
+    void report_sink::write(std::string_view text) const {
+        if(text.empty()) return;
+        switch(kind) {
+            case sink_kind::fd:
+                while(not text.empty()) {
+#ifdef _WIN32
+                    const auto written = ::_write(fd, text.data(), static_cast<unsigned>(text.size()));
+#else
+                    const auto written = ::write(fd, text.data(), text.size());
+#endif
+                    if(written < 0) {
+                        if(errno == EINTR) continue;
+                        return;
+                    }
+                    text.remove_prefix(static_cast<std::size_t>(written));
+                }
+                break;
+
+            case sink_kind::file:
+                std::fwrite(text.data(), 1, text.size(), file);
+                std::fflush(file);
+                break;
+
+            case sink_kind::stream:
+                stream->write(text.data(), static_cast<std::streamsize>(text.size()));
+                stream->flush();
+                break;
+
+            case sink_kind::callback:
+                if(callback) callback(text);
+                break;
+        }
+    }
+
+    std::size_t report_buffer::digits(std::size_t value) {
+        std::size_t width = 0;
+        do {
+            value /= 10;
+            ++width;
+        } while(value > 0);
+        return width;
+    }
+
+    report_buffer& report_buffer::operator<<(const std::string_view str) {
+        text.append(str);
+        return *this;
+    }
+
+    report_buffer& report_buffer::operator<<(const char c) {
+        text.push_back(c);
+        return *this;
+    }
+
+    report_buffer& report_buffer::operator<<(const std::size_t value) {
+        char digits[24];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        text.append(digits, result.ptr);
+        return *this;
+    }
+
+    report_buffer& report_buffer::operator<<(const void* addr) {
+        char digits[24] = { '0', 'x' };
+        const auto result = std::to_chars(digits + 2, digits + sizeof(digits), reinterpret_cast<std::uintptr_t>(addr), 16);
+        text.append(digits, result.ptr);
+        return *this;
+    }
+
+    report_buffer& report_buffer::operator<<(const repeat fill) {
+        text.append(fill.count, fill.c);
+        return *this;
+    }
+
+    report_buffer& report_buffer::operator<<(const json_escaped str) {
+        static constexpr char hex[] = "0123456789abcdef";
+        for(const char c : str.text) {
+            switch(c) {
+                case '"':  text.append("\\\""); break;
+                case '\\': text.append("\\\\"); break;
+                case '\n': text.append("\\n"); break;
+                case '\r': text.append("\\r"); break;
+                case '\t': text.append("\\t"); break;
+                default:
+                    if(static_cast<unsigned char>(c) < 0x20) {
+                        text.append("\\u00");
+                        text.push_back(hex[(c >> 4) & 0xF]);
+                        text.push_back(hex[c & 0xF]);
+                    }
+                    else text.push_back(c);
+            }
+        }
+        return *this;
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef MEMORY_TRACKER_REPORT_WRITER_HPP
+#define MEMORY_TRACKER_REPORT_WRITER_HPP
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "ansi_color.hpp"
+
+namespace suiveur {
+    /* How reports are laid out, for people or for tools. */
+    enum class report_format {
+        text,
+        json_lines,
+        sarif,
+    };
+
+    /* Accepts "text", "json", "jsonl" and "sarif". */
+    std::optional<report_format> parse_report_format(std::string_view name);
+
+    /* Where finished reports are written, each report is handed over in one piece. */
+    struct report_sink {
+        using callback_type = std::function<void(std::string_view)>;
+
+        static report_sink to_fd(int fd);
+        static report_sink to_file(std::FILE* file);
+        static report_sink to_stream(std::ostream& os);
+        static report_sink to_callback(callback_type callback);
+
+        void write(std::string_view text) const;
+
+    private:
+        enum class sink_kind {
+            fd,
+            file,
+            stream,
+            callback,
+        };
+
+        sink_kind kind = sink_kind::stream;
+        int fd = -1;
+        std::FILE* file = nullptr;
+        std::ostream* stream = nullptr;
+        callback_type callback;
+    };
+
+    /* Growable text buffer reports are formatted into, clearing it keeps the capacity. */
+    struct report_buffer {
+        struct repeat {
+            std::size_t count = 0;
+            char c = ' ';
+        };
+
+        /* Escaped for use inside a JSON string, without the quotes. */
+        struct json_escaped {
+            std::string_view text;
+        };
+
+        static std::size_t digits(std::size_t value);
+
+        report_buffer& operator<<(std::string_view text);
+        report_buffer& operator<<(const char* text) { return *this << std::string_view { text }; }
+        report_buffer& operator<<(char c);
+        report_buffer& operator<<(std::size_t value);
+        report_buffer& operator<<(const void* addr);
+        report_buffer& operator<<(const ansi::ansi_base& color) { return *this << color.color; }
+        report_buffer& operator<<(repeat fill);
+        report_buffer& operator<<(json_escaped str);
+
+        [[nodiscard]] std::string_view view() const { return text; }
+        [[nodiscard]] bool empty() const { return text.empty(); }
+        void clear() { text.clear(); }
+
+    private:
+        std::string text;
+    };
+}
+
+#endif //MEMORY_TRACKER_REPORT_WRITER_HPP
@@ -0,0 +1,86 @@
+#include "sampling.hpp"
+
+#include <cmath>
+
+#include "flat_table.hpp"
+
+namespace suiveur {
+    namespace {
+        struct sampler_state {
+            std::uint64_t rng = 0;
+            std::int64_t bytes_until_sample = -1;
+        };
+
+        thread_local sampler_state sampler {};
+
+        std::uint64_t next_random(sampler_state& state) {
+            if(state.rng == 0) state.rng = reinterpret_cast<std::uintptr_t>(&state) | 1;
+            state.rng ^= state.rng << 13;
+            state.rng ^= state.rng >> 7;
+            state.rng ^= state.rng << 17;
+            return state.rng;
+        }
+
+        /* Exponentially distributed gaps make each byte equally likely to be sampled. */
+        std::int64_t next_gap(sampler_state& state) {
+            const double uniform = double(next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+            return static_cast<std::int64_t>(-std::log1p(-uniform) * double(sample_interval)) + 1;
+        }
+
+        /* Two distinct counters of the line an address falls in. */
+        std::size_t first_index(std::uint64_t hash) { return static_cast<std::size_t>(hash >> 20) & 31; }
+        std::size_t second_index(std::uint64_t hash) { return (first_index(hash) + 1 + (hash >> 25) % 31) & 31; }
+    }
+
+    bool should_sample(const std::size_t size) {
+        if constexpr(sample_interval == 0) return true;
+        auto& state = sampler;
+        if(state.bytes_until_sample < 0) state.bytes_until_sample = next_gap(state);
+        state.bytes_until_sample -= static_cast<std::int64_t>(size);
+        if(state.bytes_until_sample > 0) return false;
+        state.bytes_until_sample = next_gap(state);
+        return true;
+    }
+
+    double sample_weight(const std::size_t size) {
+        if constexpr(sample_interval == 0) return 1.0;
+        if(size == 0) return 1.0;
+        return 1.0 / -std::expm1(-double(size) / double(sample_interval));
+    }
+
+    sample_filter::sample_filter() {
+        if constexpr(sample_interval > 0) lines = std::make_unique<line[]>(line_count);
+    }
+
+    void sample_filter::insert(const void* addr) {
+        const auto hash = address_traits<const void*>::hash(addr);
+        auto& counters = lines[hash >> (64 - line_bits)].counters;
+        for(auto idx : { first_index(hash), second_index(hash) }) {
+            auto& counter = counters[idx];
+            std::uint16_t value = counter.load(std::memory_order_relaxed);
+            while(value != UINT16_MAX and not counter.compare_exchange_weak(value, value + 1, std::memory_order_relaxed)) {}
+        }
+    }
+
+    bool sample_filter::erase(const void* addr) {
+        const auto hash = address_traits<const void*>::hash(addr);
+        auto& counters = lines[hash >> (64 - line_bits)].counters;
+        auto& first = counters[first_index(hash)];
+        auto& second = counters[second_index(hash)];
+        if(first.load(std::memory_order_relaxed) == 0 or second.load(std::memory_order_relaxed) == 0) return false;
+
+        for(auto* counter : { &first, &second }) {
+            std::uint16_t value = counter->load(std::memory_order_relaxed);
+            while(value != 0 and value != UINT16_MAX
+                  and not counter->compare_exchange_weak(value, value - 1, std::memory_order_relaxed)) {}
+        }
+        return true;
+    }
+
+    void sample_filter::clear() {
+        if(not lines) return;
+        for(std::size_t idx = 0; idx < line_count; ++idx) {
+            for(auto& counter : lines[idx].counters) counter.store(0, std::memory_order_relaxed);
+        }
+    }
+}
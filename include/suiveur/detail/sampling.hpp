@@ -0,0 +1,44 @@
+#ifndef MEMORY_TRACKER_SAMPLING_HPP
+#define MEMORY_TRACKER_SAMPLING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#ifndef SUIVEUR_SAMPLE_INTERVAL
+#   define SUIVEUR_SAMPLE_INTERVAL 0
+#endif
+
+namespace suiveur {
+    /* Mean number of bytes allocated between two sampled allocations, 0 records everything. */
+    inline constexpr std::size_t sample_interval = SUIVEUR_SAMPLE_INTERVAL;
+
+    bool should_sample(std::size_t size);
+    double sample_weight(std::size_t size);
+
+    /*
+     * Counting bloom filter over the addresses of live allocations that were
+     * not sampled, so deleting them isn't reported as untracked.
+     */
+    struct sample_filter {
+        sample_filter();
+
+        void insert(const void* addr);
+        bool erase(const void* addr);
+        void clear();
+
+    private:
+        /* Both counters of an address are in the same line, a lookup misses the cache at most once. */
+        struct alignas(64) line {
+            std::atomic<std::uint16_t> counters[32];
+        };
+
+        static constexpr unsigned line_bits = 15;
+        static constexpr std::size_t line_count = std::size_t { 1 } << line_bits;
+
+        std::unique_ptr<line[]> lines;
+    };
+}
+
+#endif //MEMORY_TRACKER_SAMPLING_HPP
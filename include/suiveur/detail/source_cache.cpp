@@ -0,0 +1,65 @@
+#include "source_cache.hpp"
+
+#include <fstream>
+#include <mutex>
+
+#include "line_index.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#   define SUIVEUR_HAS_MMAP
+#endif
+
+namespace suiveur {
+    source_file::source_file(const char* path) {
+#ifdef SUIVEUR_HAS_MMAP
+        const int fd = ::open(path, O_RDONLY);
+        if(fd >= 0) {
+            struct stat info {};
+            if(::fstat(fd, &info) == 0 and info.st_size > 0) {
+                void* mapped = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if(mapped != MAP_FAILED) {
+                    mapping = mapped;
+                    data = static_cast<const char*>(mapped);
+                    size = static_cast<std::size_t>(info.st_size);
+                }
+            }
+            ::close(fd);
+            if(mapping) return;
+        }
+#endif
+        std::ifstream is ( path, std::ios::binary | std::ios::ate );
+        if(not is) return;
+        buffer.resize(static_cast<std::size_t>(is.tellg()));
+        is.seekg(0, std::ios::beg);
+        is.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.resize(static_cast<std::size_t>(is.gcount()));
+        data = buffer.data();
+        size = buffer.size();
+    }
+
+    source_file::~source_file() {
+#ifdef SUIVEUR_HAS_MMAP
+        if(mapping) ::munmap(mapping, size);
+#endif
+    }
+
+    /* Only scans as far as the furthest line asked for so far, the next start bounds the line. */
+    std::string_view source_file::line(const std::size_t idx) {
+        if(scanned < size and line_starts.size() <= idx + 1) {
+            scanned = index_lines(text(), scanned, line_starts, idx + 2);
+        }
+        return line_at(text(), line_starts, idx);
+    }
+
+    std::string_view source_cache::line(const char* path, const std::size_t idx) {
+        if(not path) return {};
+        std::lock_guard guard { lock };
+        auto found = files.find(std::string_view { path });
+        if(found == files.end()) found = files.emplace(path, std::make_unique<source_file>(path)).first;
+        return found->second->line(idx);
+    }
+}
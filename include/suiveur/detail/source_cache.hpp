@@ -0,0 +1,45 @@
+#ifndef MEMORY_TRACKER_SOURCE_CACHE_HPP
+#define MEMORY_TRACKER_SOURCE_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "registry_mutex.hpp"
+
+namespace suiveur {
+    /* Read only view of a whole file, mapped when possible. Lines are located on first use. */
+    struct source_file {
+        explicit source_file(const char* path);
+        ~source_file();
+
+        source_file(const source_file&) = delete;
+        source_file& operator=(const source_file&) = delete;
+
+        [[nodiscard]] std::string_view text() const { return { data, size }; }
+        std::string_view line(std::size_t idx);
+
+    private:
+        const char* data = nullptr;
+        std::size_t size = 0;
+        void* mapping = nullptr;
+        std::string buffer;
+        std::vector<std::uint32_t> line_starts { 0 };
+        std::size_t scanned = 0;
+    };
+
+    /* Files referenced by reports, kept open for the lifetime of the registry. */
+    struct source_cache {
+        std::string_view line(const char* path, std::size_t idx);
+
+    private:
+        registry_mutex lock;
+        std::map<std::string, std::unique_ptr<source_file>, std::less<>> files;
+    };
+}
+
+#endif //MEMORY_TRACKER_SOURCE_CACHE_HPP
@@ -0,0 +1,79 @@
+#include "tracked_arena.hpp"
+
+#include <cstdint>
+
+#include "allocation_registry.hpp"
+#include "reentrancy_guard.hpp"
+
+namespace suiveur {
+    arena_base::arena_base(const call_site* site, const std::size_t chunk_size)
+            : site(site), chunk_size(chunk_size) {}
+
+    arena_base::~arena_base() {
+        reset();
+    }
+
+    /* Chunks are max aligned, an over-aligned request gets room to be aligned within its chunk. */
+    std::byte* arena_base::new_chunk(const std::size_t size) {
+        auto* data = static_cast<std::byte*>(::operator new(size));
+#ifdef ENABLE_MEMORY_REGISTRY
+        allocation_registry::record_allocation(data, cttype_id<arena_chunk>, site, size, allocation_kind::array, size);
+#endif
+        chunks.push_back(chunk { data, size });
+        reserved += size;
+        return data;
+    }
+
+    void arena_base::expect_destroy([[maybe_unused]] void* addr, [[maybe_unused]] const type_id type,
+                                    [[maybe_unused]] const call_site* created, [[maybe_unused]] const std::size_t size) {
+#ifdef ENABLE_MEMORY_REGISTRY
+        [[maybe_unused]] const reentrancy_guard reentrancy {};
+        pending.try_emplace(addr).first->value = pending_object { type, created, size };
+#endif
+    }
+
+    void arena_base::destroyed([[maybe_unused]] void* addr) {
+#ifdef ENABLE_MEMORY_REGISTRY
+        pending.erase(addr);
+#endif
+    }
+
+    void arena_base::reset([[maybe_unused]] const call_site* released) {
+#ifdef ENABLE_MEMORY_REGISTRY
+        for(auto& [addr, object] : pending) {
+            allocation_registry::record_undestroyed(addr, object.type, object.site, object.size, released ? released : site);
+        }
+        {
+            [[maybe_unused]] const reentrancy_guard reentrancy {};
+            pending = flat_table<void*, pending_object> {};
+        }
+#endif
+        for(auto& c : chunks) {
+#ifdef ENABLE_MEMORY_REGISTRY
+            allocation_registry::record_deletion(c.data, cttype_id<arena_chunk>, site, allocation_kind::array);
+#endif
+            ::operator delete(c.data);
+        }
+        chunks.clear();
+        reserved = 0;
+    }
+
+    /* Requests larger than a chunk get a chunk of their own, the current one keeps being filled. */
+    void* tracked_arena::allocate(const std::size_t size, const std::size_t align) {
+        auto aligned = [&](std::byte* at) {
+            const auto bits = reinterpret_cast<std::uintptr_t>(at);
+            return at + (((bits + align - 1) & ~(align - 1)) - bits);
+        };
+        const std::size_t wanted = size + (align > alignof(std::max_align_t) ? align : 0);
+        if(wanted > chunk_size) return aligned(new_chunk(wanted));
+
+        std::byte* at = cursor ? aligned(cursor) : nullptr;
+        if(not at or at + size > limit) {
+            cursor = new_chunk(chunk_size);
+            limit = cursor + chunk_size;
+            at = aligned(cursor);
+        }
+        cursor = at + size;
+        return at;
+    }
+}
@@ -0,0 +1,158 @@
+#ifndef MEMORY_TRACKER_TRACKED_ARENA_HPP
+#define MEMORY_TRACKER_TRACKED_ARENA_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "call_site.hpp"
+#include "cttypeid.hpp"
+#include "flat_table.hpp"
+#include "tracking_switch.hpp"
+
+namespace suiveur {
+    /* Type chunks of arenas and pools are recorded as. */
+    struct arena_chunk {};
+
+    /*
+     * Memory handed out from chunks that are registered with the registry as a whole,
+     * objects are not recorded individually. Objects with a destructor created while tracking
+     * is on are remembered until they are destroyed, those still there on reset are reported.
+     * Not thread safe, each arena belongs to one thread at a time.
+     */
+    struct arena_base {
+        arena_base(const arena_base&) = delete;
+        arena_base& operator=(const arena_base&) = delete;
+
+        /* Frees every chunk, released is where the report says the objects were let go. */
+        void reset(const call_site* released = nullptr);
+
+        [[nodiscard]] std::size_t chunk_count() const { return chunks.size(); }
+        [[nodiscard]] std::size_t reserved_bytes() const { return reserved; }
+
+    protected:
+        struct chunk {
+            std::byte* data = nullptr;
+            std::size_t size = 0;
+        };
+
+        struct pending_object {
+            type_id type = nullptr;
+            const call_site* site = nullptr;
+            std::size_t size = 0;
+        };
+
+        arena_base(const call_site* site, std::size_t chunk_size);
+        ~arena_base();
+
+        std::byte* new_chunk(std::size_t size);
+        void expect_destroy(void* addr, type_id type, const call_site* site, std::size_t size);
+        void destroyed(void* addr);
+
+        const call_site* site = nullptr;
+        std::size_t chunk_size = 0;
+        std::size_t reserved = 0;
+        std::vector<chunk> chunks;
+        flat_table<void*, pending_object> pending;
+    };
+
+    /* Bump pointer arena, memory is only given back all at once by reset(). */
+    struct tracked_arena : arena_base {
+        explicit tracked_arena(const call_site* site, std::size_t chunk_size = 64 * 1024) : arena_base(site, chunk_size) {}
+
+        void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t));
+
+        template <typename T, typename...TT>
+        T* create(const call_site* created, TT&&...tt) {
+            T* obj = new(allocate(sizeof(T), alignof(T))) T(std::forward<TT>(tt)...);
+            if constexpr(not std::is_trivially_destructible_v<T>) {
+                if(tracking_switch::enabled()) expect_destroy(obj, cttype_id<std::remove_cv_t<T>>, created, sizeof(T));
+            }
+            return obj;
+        }
+
+        /* Runs the destructor, the memory stays in the arena until reset. */
+        template <typename T>
+        void destroy(T* obj) {
+            if(not obj) return;
+            if constexpr(not std::is_trivially_destructible_v<T>) {
+                if(tracking_switch::watching()) destroyed(obj);
+            }
+            obj->~T();
+        }
+
+        void reset(const call_site* released = nullptr) {
+            arena_base::reset(released);
+            cursor = limit = nullptr;
+        }
+
+    private:
+        std::byte* cursor = nullptr;
+        std::byte* limit = nullptr;
+    };
+
+    /* Fixed size slots for one type, destroyed objects are reused before new chunks are taken. */
+    template <typename T>
+    struct tracked_pool : arena_base {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "chunks are only max aligned");
+
+        explicit tracked_pool(const call_site* site, const std::size_t objects_per_chunk = 256)
+                : arena_base(site, objects_per_chunk * sizeof(slot)) {}
+
+        template <typename...TT>
+        T* create(const call_site* created, TT&&...tt) {
+            T* obj = new(take()) T(std::forward<TT>(tt)...);
+            if constexpr(not std::is_trivially_destructible_v<T>) {
+                if(tracking_switch::enabled()) expect_destroy(obj, cttype_id<std::remove_cv_t<T>>, created, sizeof(T));
+            }
+            return obj;
+        }
+
+        void destroy(T* obj) {
+            if(not obj) return;
+            if constexpr(not std::is_trivially_destructible_v<T>) {
+                if(tracking_switch::watching()) destroyed(obj);
+            }
+            obj->~T();
+            auto* freed = reinterpret_cast<slot*>(obj);
+            freed->next = free_list;
+            free_list = freed;
+        }
+
+        void reset(const call_site* released = nullptr) {
+            arena_base::reset(released);
+            free_list = nullptr;
+            cursor = limit = nullptr;
+        }
+
+    private:
+        union slot {
+            slot* next;
+            alignas(T) std::byte storage[sizeof(T)];
+        };
+
+        void* take() {
+            if(free_list) {
+                slot* s = free_list;
+                free_list = s->next;
+                return s->storage;
+            }
+            if(cursor == limit) {
+                cursor = reinterpret_cast<slot*>(new_chunk(chunk_size));
+                limit = cursor + chunk_size / sizeof(slot);
+            }
+            return (cursor++)->storage;
+        }
+
+        slot* free_list = nullptr;
+        slot* cursor = nullptr;
+        slot* limit = nullptr;
+    };
+}
+
+#define ARENA_NEW(arena, type, ...)     (arena).template create<type>(SUIVEUR_CALL_SITE(), ##__VA_ARGS__)
+#define POOL_NEW(pool, ...)             (pool).create(SUIVEUR_CALL_SITE(), ##__VA_ARGS__)
+
+#endif //MEMORY_TRACKER_TRACKED_ARENA_HPP
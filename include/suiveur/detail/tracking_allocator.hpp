@@ -0,0 +1,129 @@
+#ifndef MEMORY_TRACKER_TRACKING_ALLOCATOR_HPP
+#define MEMORY_TRACKER_TRACKING_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "allocation_registry.hpp"
+#include "call_site.hpp"
+#include "cttypeid.hpp"
+
+namespace suiveur {
+    /* Where allocators and deleters that were never given a call site report their memory. */
+    inline constexpr call_site unattributed_site { "<tracking_allocator>", 0 };
+
+    /*
+     * std::allocator that records every allocation under the call site it was created with,
+     * so the memory of each container is attributed to where the container was declared.
+     * Rebound copies keep the site, and the type if one was given.
+     */
+    template <typename T>
+    struct tracking_allocator {
+        using value_type = T;
+        using propagate_on_container_move_assignment = std::true_type;
+        using is_always_equal = std::true_type;
+
+        template <typename U>
+        struct rebind {
+            using other = tracking_allocator<U>;
+        };
+
+        const call_site* site = &unattributed_site;
+        type_id type = nullptr;
+
+        tracking_allocator() noexcept = default;
+        explicit tracking_allocator(const call_site* site, const type_id type = nullptr) noexcept
+                : site(site ? site : &unattributed_site), type(type) {}
+
+        template <typename U>
+        tracking_allocator(const tracking_allocator<U>& other) noexcept : site(other.site), type(other.type) {}
+
+        T* allocate(const std::size_t n) {
+            T* ptr = std::allocator<T> {}.allocate(n);
+#ifdef ENABLE_MEMORY_REGISTRY
+            allocation_registry::record_allocation(ptr, tracked_type(), site, n * sizeof(T), kind_of(n), n);
+#endif
+            return ptr;
+        }
+
+        void deallocate(T* ptr, const std::size_t n) noexcept {
+#ifdef ENABLE_MEMORY_REGISTRY
+            allocation_registry::record_deletion(ptr, tracked_type(), site, kind_of(n));
+#endif
+            std::allocator<T> {}.deallocate(ptr, n);
+        }
+
+        template <typename U>
+        friend bool operator==(const tracking_allocator&, const tracking_allocator<U>&) noexcept { return true; }
+        template <typename U>
+        friend bool operator!=(const tracking_allocator&, const tracking_allocator<U>&) noexcept { return false; }
+
+    private:
+        [[nodiscard]] type_id tracked_type() const { return type ? type : cttype_id<std::remove_cv_t<T>>; }
+        static allocation_kind kind_of(const std::size_t n) { return n == 1 ? allocation_kind::scalar : allocation_kind::array; }
+    };
+
+    /* Deleter going through SAFE_DELETE, errors are reported and the pointer is left alone. */
+    template <typename T>
+    struct tracked_delete {
+        const call_site* site = &unattributed_site;
+
+        void operator()(T* ptr) const {
+#ifdef ENABLE_MEMORY_REGISTRY
+            do_safe_deletion(ptr, site);
+#else
+            delete ptr;
+#endif
+        }
+    };
+
+    template <typename T>
+    struct tracked_delete<T[]> {
+        const call_site* site = &unattributed_site;
+
+        void operator()(T* ptr) const {
+#ifdef ENABLE_MEMORY_REGISTRY
+            do_safe_array_deletion(ptr, site);
+#else
+            delete[] ptr;
+#endif
+        }
+    };
+
+    template <typename T>
+    using tracked_unique_ptr = std::unique_ptr<T, tracked_delete<T>>;
+
+    template <typename T, typename...TT>
+    std::enable_if_t<not std::is_array_v<T>, tracked_unique_ptr<T>> make_tracked_unique(const call_site* site, TT&&...tt) {
+        T* ptr = new T(std::forward<TT>(tt)...);
+#ifdef ENABLE_MEMORY_REGISTRY
+        register_allocation(ptr, site);
+#endif
+        return tracked_unique_ptr<T> { ptr, tracked_delete<T> { site ? site : &unattributed_site } };
+    }
+
+    template <typename T>
+    std::enable_if_t<std::is_array_v<T> and std::extent_v<T> == 0, tracked_unique_ptr<T>>
+    make_tracked_unique(const call_site* site, const std::size_t count) {
+        auto* ptr = new std::remove_extent_t<T>[count]();
+#ifdef ENABLE_MEMORY_REGISTRY
+        register_array_allocation(ptr, count, site);
+#endif
+        return tracked_unique_ptr<T> { ptr, tracked_delete<T> { site ? site : &unattributed_site } };
+    }
+
+    /* The object and its control block are one allocation, recorded once as T. */
+    template <typename T, typename...TT>
+    std::enable_if_t<not std::is_array_v<T>, std::shared_ptr<T>> make_tracked_shared(const call_site* site, TT&&...tt) {
+        const tracking_allocator<T> alloc { site, cttype_id<std::remove_cv_t<T>> };
+        return std::allocate_shared<T>(alloc, std::forward<TT>(tt)...);
+    }
+}
+
+#define TRACKING_ALLOCATOR(type)        suiveur::tracking_allocator<type> { SUIVEUR_CALL_SITE() }
+#define MAKE_TRACKED_UNIQUE(type, ...)  suiveur::make_tracked_unique<type>(SUIVEUR_CALL_SITE(), ##__VA_ARGS__)
+#define MAKE_TRACKED_SHARED(type, ...)  suiveur::make_tracked_shared<type>(SUIVEUR_CALL_SITE(), ##__VA_ARGS__)
+
+#endif //MEMORY_TRACKER_TRACKING_ALLOCATOR_HPP
@@ -0,0 +1,36 @@
+#include "tracking_switch.hpp"
+
+#include <csignal>
+#include <cstdlib>
+#include <string_view>
+
+namespace suiveur {
+    extern "C" void suiveur_toggle_tracking(int) {
+        tracking_switch::toggle();
+    }
+
+    /* Numbers, or the usual names of the signals left to applications. */
+    static int parse_signal(const std::string_view name) {
+#ifdef SIGUSR1
+        if(name == "SIGUSR1" or name == "USR1") return SIGUSR1;
+        if(name == "SIGUSR2" or name == "USR2") return SIGUSR2;
+#endif
+        if(name.empty() or name.find_first_not_of("0123456789") != std::string_view::npos) return 0;
+        return std::atoi(name.data());
+    }
+
+    bool tracking_switch::toggle_on_signal(const int signal) {
+        return signal > 0 and std::signal(signal, suiveur_toggle_tracking) != SIG_ERR;
+    }
+
+    void tracking_switch::configure_from_environment() {
+        if(const char* value = std::getenv("SUIVEUR_TRACKING")) {
+            const std::string_view setting { value };
+            if(setting == "1" or setting == "on" or setting == "true") enable();
+            else if(setting == "0" or setting == "off" or setting == "false") disable();
+        }
+        if(const char* value = std::getenv("SUIVEUR_TRACKING_SIGNAL")) {
+            toggle_on_signal(parse_signal(value));
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef MEMORY_TRACKER_TRACKING_SWITCH_HPP
+#define MEMORY_TRACKER_TRACKING_SWITCH_HPP
+
+#include <atomic>
+
+namespace suiveur {
+#ifdef SUIVEUR_START_DORMANT
+    inline constexpr bool start_dormant = true;
+#else
+    inline constexpr bool start_dormant = false;
+#endif
+
+    /*
+     * Turns recording on and off while the program runs. When dormant, allocations
+     * aren't recorded and deletions only look up pointers recorded earlier, so the
+     * macros cost a load and a branch. Set at startup by SUIVEUR_TRACKING, and
+     * toggled by the signal named in SUIVEUR_TRACKING_SIGNAL if there is one.
+     * Every change is lock free, it may be made from a signal handler.
+     */
+    struct tracking_switch {
+        enum flag : unsigned {
+            recording = 1,  /* calls are recorded */
+            holding = 2,    /* pointers recorded earlier may still be live */
+            skipped = 4,    /* allocations may have gone unrecorded, unknown pointers may be one of them */
+            stale = 8,      /* addresses in the deleted history may have been reused while dormant */
+        };
+
+        static unsigned flags() { return state.load(std::memory_order_relaxed); }
+        static bool enabled() { return flags() & recording; }
+        /* Whether deletions have to go through the registry. */
+        static bool watching() { return flags() & (recording | holding); }
+
+        static void enable() noexcept { update(true); }
+        static void disable() noexcept { update(false); }
+        static void toggle() noexcept { update(not enabled()); }
+
+        /* Toggles tracking each time the signal is raised, false if no handler could be installed. */
+        static bool toggle_on_signal(int signal);
+        /* Applies SUIVEUR_TRACKING and SUIVEUR_TRACKING_SIGNAL. */
+        static void configure_from_environment();
+
+        /* True for the one caller that gets to forget the stale history. */
+        static bool take_stale() noexcept {
+            return state.fetch_and(~unsigned { stale }, std::memory_order_relaxed) & stale;
+        }
+
+        /* Once the registry is cleared while recording, what was skipped is forgotten with the rest. */
+        static void forget_skipped() noexcept {
+            unsigned current = flags();
+            while((current & recording)
+                  and not state.compare_exchange_weak(current, current & ~unsigned { skipped }, std::memory_order_relaxed)) {}
+        }
+
+        /* Once the registry is cleared while dormant, no recorded pointer can be live. */
+        static void forget_held() noexcept {
+            unsigned current = flags();
+            while(not (current & recording)
+                  and not state.compare_exchange_weak(current, current & ~unsigned { holding }, std::memory_order_relaxed)) {}
+        }
+
+    private:
+        static void update(const bool on) noexcept {
+            unsigned current = flags();
+            unsigned next = 0;
+            do {
+                if(bool(current & recording) == on) return;
+                next = on ? current | recording | holding : (current & ~unsigned { recording }) | skipped | stale;
+            } while(not state.compare_exchange_weak(current, next, std::memory_order_relaxed));
+        }
+
+        static inline std::atomic<unsigned> state { start_dormant ? unsigned { skipped } : unsigned { recording | holding } };
+        static_assert(std::atomic<unsigned>::is_always_lock_free, "the switch is flipped from signal handlers");
+    };
+}
+
+#endif //MEMORY_TRACKER_TRACKING_SWITCH_HPP
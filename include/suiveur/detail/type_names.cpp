@@ -1,8 +0,0 @@
-#include "type_names.hpp"
-
-namespace suiveur {
-    type_names& type_names::get() {
-        static type_names names {};
-        return names;
-    }
-}
\ No newline at end of file
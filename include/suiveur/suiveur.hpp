@@ -2,11 +2,27 @@
 #define MEMORY_TRACKER_SUIVEUR_HPP
 
 #include "detail/allocation_registry.hpp"
+#include "detail/allocation_stats.hpp"
 #include "detail/ansi_color.hpp"
+#include "detail/call_site.hpp"
+#include "detail/call_stack.hpp"
+#include "detail/crash_dump.hpp"
 #include "detail/cttypeid.hpp"
+#include "detail/deleted_history.hpp"
+#include "detail/event_log.hpp"
+#include "detail/flat_table.hpp"
+#include "detail/line_index.hpp"
 #include "detail/load_file.hpp"
 #include "detail/pad_with.hpp"
 #include "detail/partition_data.hpp"
-#include "detail/type_names.hpp"
+#include "detail/quarantine.hpp"
+#include "detail/reentrancy_guard.hpp"
+#include "detail/registry_mutex.hpp"
+#include "detail/report_writer.hpp"
+#include "detail/sampling.hpp"
+#include "detail/source_cache.hpp"
+#include "detail/tracked_arena.hpp"
+#include "detail/tracking_allocator.hpp"
+#include "detail/tracking_switch.hpp"
 
 #endif //MEMORY_TRACKER_SUIVEUR_HPP
@@ -0,0 +1,46 @@
+#include <suiveur/suiveur.hpp>
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace {
+    using registry = suiveur::allocation_registry;
+
+    struct node {
+        int value[4] {};
+    };
+
+    std::string errors;
+
+    int fail(const char* what) {
+        std::printf("FAIL: %s\n", what);
+        return 1;
+    }
+}
+
+/*
+ * Pointers made by new and passed to REGISTER_ALLOC on one thread, then deleted on another.
+ * With track_global_new, operator new and REGISTER_ALLOC each record the pointer, and only
+ * one record may be left to delete.
+ */
+int main() {
+    const auto since = registry::snapshot();
+    node* freed = REGISTER_ALLOC(new node {});
+    std::thread { [&] { SAFE_DELETE(freed); } }.join();
+    if(not registry::diff(since).empty()) return fail("a pointer deleted on another thread is reported as unfreed");
+
+    node* twice = REGISTER_ALLOC(new node {});
+    std::thread { [&] { SAFE_DELETE(twice); } }.join();
+    std::thread { [&] { SAFE_DELETE(twice); } }.join();
+    registry::set_report_format(suiveur::report_format::json_lines);
+    registry::set_report_sink(suiveur::report_sink::to_callback([](std::string_view text) { errors += text; }));
+    registry::print_errors();
+    registry::set_report_sink(suiveur::report_sink::to_stream(std::cout));
+    registry::set_report_format(suiveur::report_format::text);
+    if(errors.find("\"double-delete\"") == std::string::npos) return fail("a second delete on another thread is not reported");
+
+    std::printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <suiveur/suiveur.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+    using suiveur::allocation_kind;
+    using suiveur::allocation_registry;
+    using suiveur::event_op;
+    using suiveur::event_record;
+
+    /* Sites and types named by the log, the registry keeps pointers to them. */
+    struct definitions {
+        std::deque<std::string> texts;
+        std::deque<suiveur::call_site> sites;
+        std::deque<suiveur::type_descriptor> types;
+        suiveur::flat_table<const void*, const suiveur::call_site*> site_ids;
+        suiveur::flat_table<const void*, suiveur::type_id> type_ids;
+
+        static const void* key(const std::uint64_t id) {
+            return reinterpret_cast<const void*>(static_cast<std::uintptr_t>(id));
+        }
+
+        bool read(std::FILE* file, const event_record& def) {
+            auto& text = texts.emplace_back(static_cast<std::size_t>(def.count), '\0');
+            const std::size_t padded = (text.size() + sizeof(event_record) - 1) / sizeof(event_record) * sizeof(event_record);
+            if(std::fread(text.data(), 1, text.size(), file) != text.size()) return false;
+            if(std::fseek(file, static_cast<long>(padded - text.size()), SEEK_CUR) != 0) return false;
+
+            if(def.op == event_op::define_site) {
+                site_ids.try_emplace(key(def.address)).first->value = &sites.emplace_back(
+                        suiveur::call_site { text.c_str(), static_cast<std::size_t>(def.size) });
+            }
+            else {
+                type_ids.try_emplace(key(def.address)).first->value = &types.emplace_back(
+                        suiveur::type_descriptor { text, def.size });
+            }
+            return true;
+        }
+
+        const suiveur::call_site* site(const std::uint64_t id) {
+            auto* entry = id ? site_ids.find(key(id)) : nullptr;
+            return entry ? entry->value : nullptr;
+        }
+
+        suiveur::type_id type(const std::uint64_t id) {
+            auto* entry = id ? type_ids.find(key(id)) : nullptr;
+            return entry ? entry->value : suiveur::cttype_id<void>;
+        }
+    };
+
+    void replay(const event_record& record, definitions& defs) {
+        auto* addr = reinterpret_cast<void*>(static_cast<std::uintptr_t>(record.address));
+        const auto kind = static_cast<allocation_kind>(record.kind);
+        switch(record.op) {
+            case event_op::allocation:
+                allocation_registry::record_allocation(addr, defs.type(record.type), defs.site(record.site),
+                                                       record.size, kind, record.count);
+                break;
+            case event_op::deletion:
+                allocation_registry::record_deletion(addr, defs.type(record.type), defs.site(record.site), kind);
+                break;
+            case event_op::safe_deletion:
+                allocation_registry::safe_deletion(addr, defs.type(record.type), defs.site(record.site), kind);
+                break;
+            case event_op::global_allocation:
+                allocation_registry::record_global_allocation(addr, record.size, kind, definitions::key(record.site));
+                break;
+            case event_op::global_deletion:
+                allocation_registry::record_global_deletion(addr, kind);
+                break;
+            case event_op::reset:
+                allocation_registry::erase();
+                break;
+            case event_op::pass:
+                allocation_registry::pass();
+                break;
+            default:
+                break;
+        }
+    }
+
+    /* Errors only come from crash dumps, their sites are in the detail record that follows. */
+    void restore(const event_record& record, const event_record& detail, definitions& defs) {
+        using error_key = allocation_registry::error_key;
+        allocation_registry::allocation_key key {
+            reinterpret_cast<void*>(static_cast<std::uintptr_t>(record.address)), defs.type(record.type),
+            defs.site(detail.site), static_cast<std::size_t>(detail.size), static_cast<allocation_kind>(record.kind),
+            static_cast<std::size_t>(detail.count)
+        };
+        key.deletion_point.site = defs.site(detail.address);
+        key.caller = definitions::key(detail.timestamp);
+        key.interposed = record.thread != 0;
+        const error_key error {
+            key, allocation_registry::data_location { defs.site(record.site) },
+            static_cast<error_key::error_type>(record.reserved), defs.type(detail.type)
+        };
+        allocation_registry::restore_error(error, static_cast<std::size_t>(record.count), static_cast<std::size_t>(record.size));
+    }
+}
+
+int main(int argc, char** argv) {
+    if(argc != 2) {
+        std::fprintf(stderr, "usage: %s <event log or crash dump>\n", argv[0]);
+        return 2;
+    }
+    /* Replaying goes through the registry, it must not log itself nor be dormant. */
+#ifdef SUIVEUR_EVENT_LOG
+    suiveur::event_log::close();
+#endif
+    suiveur::tracking_switch::enable();
+
+    std::FILE* file;
+    definitions* defs;
+    std::vector<std::pair<event_record, event_record>>* errors;
+    {
+        [[maybe_unused]] const suiveur::reentrancy_guard reentrancy {};
+        /* The registry reports at exit, after main's locals are gone. */
+        defs = new definitions {};
+        errors = new std::vector<std::pair<event_record, event_record>> {};
+        file = std::fopen(argv[1], "rb");
+        suiveur::event_log_header header;
+        const suiveur::event_log_header expected {};
+        if(not file or std::fread(&header, sizeof(header), 1, file) != 1
+           or std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+           or header.record_size != sizeof(event_record)) {
+            std::fprintf(stderr, "%s: not a suiveur event log\n", argv[1]);
+            return 1;
+        }
+    }
+
+    for(;;) {
+        event_record record;
+        {
+            /* Only the replayed calls may reach the registry, not the analyzer's own allocations. */
+            [[maybe_unused]] const suiveur::reentrancy_guard reentrancy {};
+            if(std::fread(&record, sizeof(record), 1, file) != 1) break;
+            if(record.op == event_op::define_site or record.op == event_op::define_type) {
+                if(not defs->read(file, record)) break;
+                continue;
+            }
+            if(record.op == event_op::error) {
+                event_record detail;
+                if(std::fread(&detail, sizeof(detail), 1, file) != 1) break;
+                errors->emplace_back(record, detail);
+                continue;
+            }
+        }
+        replay(record, *defs);
+    }
+    std::fclose(file);
+
+    /* Restored in the order they were first seen, as the program would have listed them. */
+    {
+        [[maybe_unused]] const suiveur::reentrancy_guard reentrancy {};
+        std::stable_sort(errors->begin(), errors->end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first.timestamp < rhs.first.timestamp;
+        });
+    }
+    for(const auto& [record, detail] : *errors) restore(record, detail, *defs);
+
+#ifndef ENABLE_MEMORY_REGISTRY
+    allocation_registry::print_report();
+#endif
+}